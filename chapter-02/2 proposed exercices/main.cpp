@@ -1,40 +1,176 @@
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <numeric>
+#include <utility>
+#include <vector>
 
 /**
  * Implementation of std::any_of, std::all_of, std::find_if algorithms
- * using std::accumulate (left fold algorithm).
+ * using a left fold.
+ *
+ * std::accumulate always traverses the whole collection, even when the
+ * result is already known after the first element. fold_while is a left
+ * fold which lets the folding function stop the traversal early.
  */
 
+// The result of a single folding step: the new accumulated value, and
+// whether the fold should go on with the rest of the collection
+template <typename T> struct fold_step {
+  T value;
+  bool done;
+};
+
+template <typename T> constexpr auto continue_with(T value) -> fold_step<T> {
+  return {std::move(value), false};
+}
+
+template <typename T> constexpr auto stop_with(T value) -> fold_step<T> {
+  return {std::move(value), true};
+}
+
+// Left fold with early termination. The folding function
+// returns a fold_step, and the fold stops as soon as one
+// of the steps is marked as done.
+// O(n) in the worst case, stops at the first decisive element.
+template <typename It, typename T, typename F>
+constexpr auto fold_while(It first, It last, T init, F folding_function) -> T {
+  for (; first != last; ++first) {
+    auto step = folding_function(std::move(init), *first);
+    init = std::move(step.value);
+    if (step.done) {
+      break;
+    }
+  }
+  return init;
+}
+
 // Check if a predicate is true for any of the elements in a collection.
 // Return true if a least one element in the collection yields true, false
 // otherwise. If the collection is empty returns false.
+// O(n), stops at the first element that satisfies the predicate.
+template <typename C, typename P>
+constexpr auto any_of(const C &collection, P predicate) -> bool {
+  return fold_while(begin(collection), end(collection), false,
+                    [&predicate](bool, const auto &item) {
+                      return predicate(item) ? stop_with(true)
+                                             : continue_with(false);
+                    });
+}
+
+// Check if a predicate is true for all of the elements in a collection.
+// Return true if all elements in the collection yield true, false
+// otherwise. If the collection is empty returns true.
+// O(n), stops at the first element that does not satisfy the predicate.
+template <typename C, typename P>
+constexpr auto all_of(const C &collection, P predicate) -> bool {
+  return fold_while(begin(collection), end(collection), true,
+                    [&predicate](bool, const auto &item) {
+                      return predicate(item) ? continue_with(true)
+                                             : stop_with(false);
+                    });
+}
+
+// Searches for the first element which predicate is true.
+// Return an iterator to the first element that satisfies the condition or
+// last if it's not found.
+// The accumulated value is the iterator to the current element,
+// it stops moving forward when the predicate is satisfied.
+// O(n), stops at the found element.
+template <typename C, typename P>
+constexpr auto find_if(C &&collection, P predicate) {
+  return fold_while(begin(collection), end(collection), begin(collection),
+                    [&predicate](auto iter, const auto &item) {
+                      return predicate(item) ? stop_with(iter)
+                                             : continue_with(std::next(iter));
+                    });
+}
+
+// Merge sort
+// A stable sorting algorithm which sorts short runs of the collection
+// with an in-place insertion sort, and then merges the neighbouring
+// sorted runs, doubling their length, until the whole collection is
+// sorted. The runs are merged back and forth between the collection
+// and a single scratch copy of it, so unlike the accumulate-based
+// insertion_sort it does not create a new collection for every item.
+//
+// Everything is constexpr, so it can be used to sort a std::array
+// at compile time, for example to bake in a sorted lookup table.
+// O(n log n)
+template <typename It, typename Compare>
+constexpr auto insertion_sort_run(It first, It last, Compare less) -> void {
+  if (first == last) {
+    return;
+  }
+  for (auto it = std::next(first); it != last; ++it) {
+    auto item = std::move(*it);
+    auto pos = it;
+    for (; pos != first && less(item, *std::prev(pos)); --pos) {
+      *pos = std::move(*std::prev(pos));
+    }
+    *pos = std::move(item);
+  }
+}
+
+template <typename C, typename Compare = std::less<>>
+constexpr auto merge_sort(C container, Compare less = {}) -> C {
+  constexpr std::ptrdiff_t run_size = 16;
+  const auto size = std::distance(begin(container), end(container));
+
+  for (std::ptrdiff_t run = 0; run < size; run += run_size) {
+    insertion_sort_run(begin(container) + run,
+                       begin(container) + std::min(run + run_size, size),
+                       less);
+  }
+  if (size <= run_size) {
+    return container;
+  }
+
+  C buffer = container;
+  C *from = &container;
+  C *to = &buffer;
+  for (auto width = run_size; width < size; width *= 2) {
+    for (std::ptrdiff_t run = 0; run < size; run += 2 * width) {
+      const auto mid = std::min(run + width, size);
+      const auto last = std::min(run + 2 * width, size);
+      std::merge(std::make_move_iterator(begin(*from) + run),
+                 std::make_move_iterator(begin(*from) + mid),
+                 std::make_move_iterator(begin(*from) + mid),
+                 std::make_move_iterator(begin(*from) + last),
+                 begin(*to) + run, less);
+    }
+    std::swap(from, to);
+  }
+
+  return std::move(*from);
+}
+
+// The previous implementations, using std::accumulate,
+// kept for comparison. They always traverse the whole collection.
+namespace accumulate_based {
+
 // O(n)
 template <typename C, typename P>
-constexpr auto any_of(C collection, P predicate) -> bool {
+constexpr auto any_of(const C &collection, P predicate) -> bool {
   return std::accumulate(begin(collection), end(collection), false,
                          [&predicate](const auto &lhs, const auto &rhs) {
                            return lhs || predicate(rhs);
                          });
 }
 
-// Check if a predicate is true for all of the elements in a collection.
-// Return true if all elements in the collection yield true, false
-// otherwise. If the collection is empty returns true.
 // O(n)
 template <typename C, typename P>
-constexpr auto all_of(C collection, P predicate) -> bool {
+constexpr auto all_of(const C &collection, P predicate) -> bool {
   return std::accumulate(begin(collection), end(collection), true,
                          [&predicate](const auto &lhs, const auto &rhs) {
                            return lhs && predicate(rhs);
                          });
 }
 
-// Searches for the first element which predicate is true.
-// Return an iterator to the first element that satisfies the condition or
-// last if it's not found.
 // Right Fold, using reverse iterators. O(n)
 template <typename C, typename P>
 constexpr auto find_if(C &&collection, P predicate) {
@@ -62,6 +198,44 @@ template <typename C> constexpr auto insertion_sort(C container) {
       });
 }
 
+} // namespace accumulate_based
+
+// Pseudo-random numbers, so that the tables can be
+// generated at compile time
+template <std::size_t N> constexpr auto random_table(unsigned int seed) {
+  std::array<int, N> result{};
+  for (auto &item : result) {
+    seed = seed * 1103515245u + 12345u;
+    item = static_cast<int>((seed >> 16) % 10000);
+  }
+  return result;
+}
+
+// A lookup table which is sorted while compiling
+constexpr auto sorted_table = merge_sort(random_table<1000>(42));
+
+// Building with -DCOMPILE_TIME_BENCHMARK also sorts a smaller table
+// at compile time with the accumulate-based insertion sort (see the
+// compile-time-benchmark target in the Makefile). With 1000 items,
+// insertion_sort exceeds the default constexpr operations limit of GCC.
+#ifdef COMPILE_TIME_BENCHMARK
+static_assert([] {
+  const auto table = random_table<250>(42);
+  const auto sorted = accumulate_based::insertion_sort(
+      std::vector<int>(begin(table), end(table)));
+  return std::equal(begin(sorted), end(sorted),
+                    begin(merge_sort(table)));
+}());
+#endif
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
 auto main() -> int {
 
   // Some tests
@@ -82,9 +256,18 @@ auto main() -> int {
     return items;
   }();
 
+  // fold_while stops at the first decisive element
+  static_assert(fold_while(begin(items_3), end(items_3), 0,
+                           [](int visited, int item) {
+                             return item < 10 ? continue_with(visited + 1)
+                                              : stop_with(visited + 1);
+                           }) == 11);
+  static_assert(fold_while(begin(items_0), end(items_0), 42,
+                           [](int, int) { return stop_with(0); }) == 42);
+
   // any_of
 
-  // O(n)
+  // O(n) with break.
   static_assert(any_of(items_0, is_odd) == false);
   static_assert(any_of(items_1, is_odd) == false);
   static_assert(any_of(items_2, is_odd) == true);
@@ -98,7 +281,7 @@ auto main() -> int {
 
   // all_of
 
-  // O(n)
+  // O(n) with break.
   static_assert(all_of(items_0, is_odd) == true);
   static_assert(all_of(items_1, is_odd) == false);
   static_assert(all_of(items_2, is_odd) == false);
@@ -112,14 +295,21 @@ auto main() -> int {
 
   // find_if
 
-  // Right Fold
-  // O(n)
+  // O(n) with break.
   static_assert(find_if(items_0, is_odd) == end(items_0));
   static_assert(find_if(items_1, is_odd) == end(items_1));
   static_assert(*find_if(items_2, is_odd) == 3);
   static_assert(*find_if(items_3, is_odd) == 1);
   static_assert(find_if(items_4, std::not_fn(is_odd)) == end(items_4));
 
+  // O(n)
+  static_assert(accumulate_based::find_if(items_0, is_odd) == end(items_0));
+  static_assert(accumulate_based::find_if(items_1, is_odd) == end(items_1));
+  static_assert(*accumulate_based::find_if(items_2, is_odd) == 3);
+  static_assert(*accumulate_based::find_if(items_3, is_odd) == 1);
+  static_assert(accumulate_based::find_if(items_4, std::not_fn(is_odd)) ==
+                end(items_4));
+
   // O(n) with break
   static_assert(std::find_if(begin(items_0), end(items_0), is_odd) ==
                 end(items_0));
@@ -130,16 +320,88 @@ auto main() -> int {
   static_assert(std::find_if(begin(items_4), end(items_4),
                              std::not_fn(is_odd)) == end(items_4));
 
+  // merge_sort
+  // O(n log n)
+  if (merge_sort(std::vector<int>()) != std::vector<int>())
+    throw;
+  if (merge_sort(std::vector{2}) != std::vector{2})
+    throw;
+  if (merge_sort(std::vector{2, 0}) != std::vector{0, 2})
+    throw;
+  if (merge_sort(std::vector{3, 2, 0}) != std::vector{0, 2, 3})
+    throw;
+
+  // At compile time
+  static_assert(merge_sort(items_0) == items_0);
+  static_assert(merge_sort(items_2) == std::array{0, 2, 3});
+  static_assert(merge_sort(items_3) == items_3);
+  static_assert(merge_sort(items_3, std::greater<>())[0] == 999);
+  static_assert(std::is_sorted(begin(sorted_table), end(sorted_table)));
+  static_assert(std::binary_search(begin(sorted_table), end(sorted_table),
+                                   sorted_table[500]));
+
+  // Stable -- the items that compare equal keep their order
+  {
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < 100; ++i) {
+      pairs.emplace_back(i % 7, i);
+    }
+    auto by_key = [](const auto &lhs, const auto &rhs) {
+      return lhs.first < rhs.first;
+    };
+    auto expected = pairs;
+    std::stable_sort(begin(expected), end(expected), by_key);
+    if (merge_sort(pairs, by_key) != expected)
+      throw;
+  }
+
   // insertion_sort
   // O(n^2)
-  if (insertion_sort(std::vector<int>()) != std::vector<int>())
+  if (accumulate_based::insertion_sort(std::vector{3, 2, 0}) !=
+      std::vector{0, 2, 3})
     throw;
-  if (insertion_sort(std::vector{2}) != std::vector{2})
+
+  // Benchmark, the first odd number is at the beginning
+  // of the collection
+  std::vector<int> numbers(10000000, 0);
+  numbers[1] = 1;
+  bool found = false;
+
+  const auto fold_while_time = measure([&] { found = any_of(numbers, is_odd); });
+  if (!found)
     throw;
-  if (insertion_sort(std::vector{2, 0}) != std::vector{0, 2})
+
+  const auto std_time = measure([&] {
+    found = std::any_of(cbegin(numbers), cend(numbers), is_odd);
+  });
+  if (!found)
     throw;
-  if (insertion_sort(std::vector{3, 2, 0}) != std::vector{0, 2, 3})
+
+  const auto accumulate_time = measure(
+      [&] { found = accumulate_based::any_of(numbers, is_odd); });
+  if (!found)
+    throw;
+
+  std::cout << "any_of (fold_while):  " << fold_while_time << "ms\n"
+            << "std::any_of:          " << std_time << "ms\n"
+            << "any_of (accumulate):  " << accumulate_time << "ms\n";
+
+  // Sorting benchmark
+  const auto table = random_table<10000>(7);
+  std::vector<int> unsorted(begin(table), end(table));
+  std::vector<int> sorted;
+
+  const auto merge_sort_time = measure([&] { sorted = merge_sort(unsorted); });
+  if (!std::is_sorted(begin(sorted), end(sorted)))
+    throw;
+
+  const auto insertion_sort_time = measure(
+      [&] { sorted = accumulate_based::insertion_sort(unsorted); });
+  if (!std::is_sorted(begin(sorted), end(sorted)))
     throw;
 
+  std::cout << "merge_sort:      " << merge_sort_time << "ms\n"
+            << "insertion_sort:  " << insertion_sort_time << "ms\n";
+
   return 0;
 }
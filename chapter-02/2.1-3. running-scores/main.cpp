@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "person.h"
+#include "scan.h"
+
+// Where average_score from 2.1-3 folds the scores into a single
+// number, a scan keeps all the intermediate results -- the running
+// totals of the scores after every game
+auto running_totals(const std::vector<int> &scores) -> std::vector<int> {
+  std::vector<int> result(scores.size());
+  scan::inclusive(scan::par, scores.cbegin(), scores.cend(), result.begin(),
+                  scan::sum<int>());
+  return result;
+}
+
+// The best score achieved up to every game
+auto running_best(const std::vector<int> &scores) -> std::vector<int> {
+  std::vector<int> result(scores.size());
+  scan::inclusive(scan::par, scores.cbegin(), scores.cend(), result.begin(),
+                  scan::maximum<int>());
+  return result;
+}
+
+auto is_female(const person_t &person) -> bool {
+  return person.gender() == person_t::female;
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+  const std::vector<int> scores{1, 2, 3, 4, 3, 5};
+
+  for (auto total : running_totals(scores)) {
+    std::cout << total << ' ';
+  }
+  std::cout << '\n';
+
+  for (auto best : running_best(scores)) {
+    std::cout << best << ' ';
+  }
+  std::cout << '\n';
+
+  // Filtering in parallel, using the exclusive scan to find out
+  // where every female person goes in the result
+  std::vector<person_t> people{
+      {"David", person_t::male},    {"Jane", person_t::female},
+      {"Martha", person_t::female}, {"Peter", person_t::male},
+      {"Rose", person_t::female},   {"Tom", person_t::male}};
+
+  std::vector<person_t> females(people.size());
+  females.erase(scan::copy_if(scan::par, people.cbegin(), people.cend(),
+                              females.begin(), is_female),
+                females.end());
+
+  for (const auto &person : females) {
+    std::cout << person.name() << '\n';
+  }
+
+  // Some tests, comparing with the standard scans
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  std::vector<int> xs(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    xs[i] = static_cast<int>(i % 17) - 8;
+  }
+
+  std::vector<int> expected(size);
+  std::vector<int> actual(size);
+
+  auto check_inclusive = [&](const auto &policy, const char *name) {
+    std::fill(actual.begin(), actual.end(), 0);
+    const auto time = measure([&] {
+      scan::inclusive(policy, xs.cbegin(), xs.cend(), actual.begin(),
+                      scan::sum<int>());
+    });
+    if (actual != expected)
+      throw;
+    std::cout << "inclusive scan (" << name << "): " << time << "ms\n";
+  };
+
+  const auto std_time = measure([&] {
+    std::inclusive_scan(xs.cbegin(), xs.cend(), expected.begin());
+  });
+  std::cout << "std::inclusive_scan:   " << std_time << "ms\n";
+  check_inclusive(scan::seq, "seq ");
+  check_inclusive(scan::simd, "simd");
+  check_inclusive(scan::par, "par ");
+
+  std::exclusive_scan(xs.cbegin(), xs.cend(), expected.begin(), 0);
+  for (const auto &policy : {scan::par, scan::parallel_policy{3, 1000}}) {
+    scan::exclusive(policy, xs.cbegin(), xs.cend(), actual.begin(),
+                    scan::sum<int>());
+    if (actual != expected)
+      throw;
+  }
+  scan::exclusive(scan::simd, xs.cbegin(), xs.cend(), actual.begin(),
+                  scan::sum<int>());
+  if (actual != expected)
+    throw;
+
+  // Scans with a custom monoid, on a type
+  // that can not use the SIMD version
+  std::vector<std::string> words{"a", "b", "c", "d", "e"};
+  std::vector<std::string> prefixes(words.size());
+  scan::inclusive(scan::simd, words.cbegin(), words.cend(), prefixes.begin(),
+                  scan::monoid(std::string(), std::plus<std::string>()));
+  if (prefixes.back() != "abcde")
+    throw;
+
+  // Parallel compaction gives the same result as std::copy_if
+  std::vector<int> odd_expected;
+  std::copy_if(xs.cbegin(), xs.cend(), std::back_inserter(odd_expected),
+               [](int x) { return x % 2 != 0; });
+  std::vector<int> odd(size);
+  odd.erase(scan::copy_if(scan::parallel_policy{4, 1000}, xs.cbegin(),
+                          xs.cend(), odd.begin(),
+                          [](int x) { return x % 2 != 0; }),
+            odd.end());
+  if (odd != odd_expected)
+    throw;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tracked.h"
+
+// The accumulator is wrapped in tracked<T> (see 2.16..) so that
+// we can check that it never gets copied
+using accumulate_test = tracked<std::vector<std::string>>;
+
+// moving_accumulate from 2.16
+template <typename BeginIt, typename EndIt, typename T, typename F>
+T moving_accumulate(BeginIt first, const EndIt &last, T init,
+                    F folding_function) {
+  for (; first != last; ++first) {
+    init = folding_function(std::move(init), *first);
+  }
+  return init;
+}
+
+// A parallel version of moving_accumulate. The collection is split
+// into chunks which are folded concurrently, each with its own
+// accumulator, and the partial results are then combined pairwise,
+// like a tree, until only one is left.
+//
+// Unlike moving_accumulate, this needs a combining function that
+// merges two accumulated values, and its identity element -- the
+// value which combined with any other gives that other value back.
+// The first chunk starts from init, and every other chunk from a copy
+// of the identity. The combining function has to be associative, but
+// since the order of the elements is preserved, it does not need to
+// be commutative. Apart from the copies of the identity, the
+// accumulators are always moved, never copied.
+template <typename It, typename T, typename F, typename C>
+T parallel_moving_accumulate(
+    It first, It last, T init, const T &identity, F folding_function,
+    C combine, unsigned int threads = std::thread::hardware_concurrency()) {
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  const auto chunks = std::max<std::size_t>(
+      1, std::min<std::size_t>(std::max(threads, 1u), size));
+
+  if (chunks == 1) {
+    return moving_accumulate(first, last, std::move(init), folding_function);
+  }
+
+  const auto chunk_size = size / chunks;
+  std::vector<std::future<T>> partial_results;
+  partial_results.reserve(chunks);
+  for (std::size_t i = 0; i < chunks; ++i) {
+    auto begin = std::next(first, i * chunk_size);
+    auto end = i + 1 == chunks ? last : std::next(begin, chunk_size);
+    partial_results.push_back(std::async(
+        std::launch::async,
+        [begin, end, &folding_function](T acc) {
+          return moving_accumulate(begin, end, std::move(acc),
+                                   folding_function);
+        },
+        i == 0 ? std::move(init) : T(identity)));
+  }
+
+  std::vector<T> results;
+  results.reserve(chunks);
+  for (auto &result : partial_results) {
+    results.push_back(result.get());
+  }
+
+  // Combining the neighbouring results, every level of the tree
+  // halves the number of accumulators
+  while (results.size() > 1) {
+    std::vector<std::future<T>> combined;
+    combined.reserve((results.size() + 1) / 2);
+    for (std::size_t i = 0; i + 1 < results.size(); i += 2) {
+      combined.push_back(std::async(
+          std::launch::async,
+          [&combine](T left, T right) {
+            return combine(std::move(left), std::move(right));
+          },
+          std::move(results[i]), std::move(results[i + 1])));
+    }
+
+    std::vector<T> next;
+    next.reserve(combined.size() + 1);
+    for (auto &result : combined) {
+      next.push_back(result.get());
+    }
+    if (results.size() % 2 != 0) {
+      next.push_back(std::move(results.back()));
+    }
+    results = std::move(next);
+  }
+
+  return std::move(results.front());
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<int> xs(1000);
+  std::iota(xs.begin(), xs.end(), 1);
+
+  auto fold = [](accumulate_test acc, int x) {
+    acc->push_back(std::to_string(x));
+    return acc;
+  };
+
+  // Appending the strings of the right accumulator
+  // to the left one, moving them as well
+  auto combine = [](accumulate_test left, accumulate_test right) {
+    left->insert(left->end(), std::make_move_iterator(right->begin()),
+                 std::make_move_iterator(right->end()));
+    return left;
+  };
+
+  auto expected =
+      moving_accumulate(xs.cbegin(), xs.cend(), accumulate_test(), fold);
+
+  // some tests
+  const accumulate_test no_strings;
+  for (unsigned int threads : {1u, 2u, 3u, 4u, 8u}) {
+    accumulate_test::reset();
+    auto result = parallel_moving_accumulate(xs.cbegin(), xs.cend(),
+                                             accumulate_test(), no_strings,
+                                             fold, combine, threads);
+
+    if (result != expected)
+      throw;
+
+    // Only the identity is copied, once for every chunk but the first
+    const auto report = accumulate_test::report();
+    if (report.copies() != threads - 1)
+      throw;
+
+    std::cout << threads << " threads: " << report.copies() << " copies, "
+              << report.moves() << " moves\n";
+  }
+
+  // Works for any associative operation with an identity
+  if (parallel_moving_accumulate(xs.cbegin(), xs.cend(), 0, 0,
+                                 std::plus<int>(), std::plus<int>(), 4) !=
+      500500)
+    throw;
+  if (parallel_moving_accumulate(xs.cbegin(), xs.cbegin() + 10, 1LL, 1LL,
+                                 std::multiplies<long long>(),
+                                 std::multiplies<long long>(), 4) != 3628800)
+    throw;
+  auto min = [](int left, int right) { return std::min(left, right); };
+  if (parallel_moving_accumulate(xs.cbegin(), xs.cend(), 2000,
+                                 std::numeric_limits<int>::max(), min, min,
+                                 4) != 1)
+    throw;
+  // The seed is only added once, not once for every chunk
+  if (parallel_moving_accumulate(xs.cbegin(), xs.cend(), 100, 0,
+                                 std::plus<int>(), std::plus<int>(), 4) !=
+      500600)
+    throw;
+
+  std::cout << "accumulate finished" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "tracked.h"
+
+// Instead of the accumulate_test class from 2.16 which prints
+// a line for every constructor and assignment operator call,
+// we are wrapping the accumulator in tracked<T> which counts them.
+// The vector uses a tracking_allocator with the same tag, so
+// the report also shows how many times the strings buffer
+// got (re)allocated.
+struct accumulator_tag {};
+
+using strings_t =
+    std::vector<std::string, tracking_allocator<std::string, accumulator_tag>>;
+using accumulator_t = tracked<strings_t, accumulator_tag>;
+
+// moving_accumulate from 2.16
+template <typename BeginIt, typename EndIt, typename T, typename F>
+T moving_accumulate(BeginIt first, const EndIt &last, T init,
+                    F folding_function) {
+  for (; first != last; ++first) {
+    init = folding_function(std::move(init), *first);
+  }
+  return init;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<int> xs(1000);
+  std::iota(xs.begin(), xs.end(), 1);
+
+  auto append = [](accumulator_t acc, int x) {
+    acc->push_back(std::to_string(x));
+    return acc;
+  };
+
+  // std::accumulate (before C++20) copies the accumulator
+  // into the folding function for every element
+  accumulator_t::reset();
+  const auto copied = std::accumulate(xs.cbegin(), xs.cend(), accumulator_t(),
+                                      append);
+  const auto accumulate_report = accumulator_t::report();
+
+  accumulator_t::reset();
+  const auto moved = moving_accumulate(xs.cbegin(), xs.cend(),
+                                       accumulator_t(), append);
+  const auto moving_report = accumulator_t::report();
+
+  std::cout << "std::accumulate:\n"
+            << accumulate_report << '\n'
+            << "moving_accumulate:\n"
+            << moving_report;
+
+  // some tests
+  if (copied != moved)
+    throw;
+
+  // moving_accumulate never copies the accumulator, so the strings
+  // buffer only gets reallocated when the vector grows
+  if (moving_report.copies() != 0)
+    throw;
+  if (moving_report.allocations > 16)
+    throw;
+
+  // Every tracked value is destroyed, apart from the result
+  if (moving_report.alive() != 1)
+    throw;
+
+  return 0;
+}
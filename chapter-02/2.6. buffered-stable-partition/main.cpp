@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+typedef std::pair<std::string, bool> list_item_t;
+
+std::string title(const list_item_t &item) {
+  return item.first + std::string(static_cast<size_t>(item.second), '*');
+}
+
+bool is_selected(const list_item_t &item) { return item.second; }
+
+bool is_not_selected(const list_item_t &item) { return !item.second; }
+
+// std::stable_partition allocates a temporary buffer as big as the
+// range on every call (or falls back to an O(n log n) algorithm when
+// the allocation fails). The functions below take the buffer from the
+// caller instead, so it can be reused between calls.
+
+// Stable partition of a single block using the provided scratch space.
+// The elements satisfying the predicate are moved forward in place,
+// the rest are parked in the buffer and moved back behind them.
+// Returns the partition point. O(n)
+template <typename It, typename BufferIt, typename P>
+auto stable_partition_block(It first, It last, BufferIt buffer, P predicate)
+    -> It {
+  auto out = first;
+  auto parked = buffer;
+  for (; first != last; ++first) {
+    if (predicate(*first)) {
+      if (out != first) {
+        *out = std::move(*first);
+      }
+      ++out;
+    } else {
+      *parked++ = std::move(*first);
+    }
+  }
+  std::move(buffer, parked, out);
+  return out;
+}
+
+// Stable partition which splits the range into chunks, partitions
+// every chunk on a separate thread and then merges the partitioned
+// blocks pairwise. Merging two neighbouring blocks [T1 F1][T2 F2]
+// is a rotation of F1 T2 which happens in place, so the only
+// scratch memory needed is the caller-supplied buffer.
+// O(n log chunks) with no allocations when the buffer is big enough.
+template <typename It, typename P,
+          typename T = typename std::iterator_traits<It>::value_type>
+auto stable_partition_with(It first, It last, P predicate,
+                           std::vector<T> &buffer,
+                           unsigned int threads =
+                               std::thread::hardware_concurrency()) -> It {
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  if (buffer.size() < size) {
+    buffer.resize(size);
+  }
+
+  // Threads are not worth it for small collections
+  constexpr std::size_t min_chunk_size = 1 << 14;
+  const auto chunks = std::max<std::size_t>(
+      1, std::min<std::size_t>(threads, size / min_chunk_size));
+
+  if (chunks == 1) {
+    return stable_partition_block(first, last, buffer.begin(), predicate);
+  }
+
+  struct block_t {
+    It begin, mid, end;
+  };
+  std::vector<block_t> blocks(chunks);
+
+  std::vector<std::thread> workers;
+  workers.reserve(chunks - 1);
+  const auto chunk_size = size / chunks;
+  for (std::size_t i = 0; i < chunks; ++i) {
+    const auto offset = i * chunk_size;
+    auto begin = first + offset;
+    auto end = i + 1 == chunks ? last : begin + chunk_size;
+    auto work = [=, &blocks, &buffer] {
+      blocks[i] = {begin,
+                   stable_partition_block(begin, end, buffer.begin() + offset,
+                                          predicate),
+                   end};
+    };
+    if (i + 1 == chunks) {
+      work();
+    } else {
+      workers.emplace_back(work);
+    }
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  // Merging the partitioned blocks like a tree -- every level
+  // halves the number of blocks
+  while (blocks.size() > 1) {
+    std::vector<block_t> merged((blocks.size() + 1) / 2);
+    workers.clear();
+    for (std::size_t i = 0; i + 1 < blocks.size(); i += 2) {
+      auto work = [&merged, &blocks, i] {
+        const auto &left = blocks[i];
+        const auto &right = blocks[i + 1];
+        merged[i / 2] = {left.begin,
+                         std::rotate(left.mid, right.begin, right.mid),
+                         right.end};
+      };
+      workers.emplace_back(work);
+    }
+    if (blocks.size() % 2 != 0) {
+      merged.back() = blocks.back();
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    blocks = std::move(merged);
+  }
+
+  return blocks.front().mid;
+}
+
+// When the caller does not provide a buffer, the one owned by the
+// current thread is reused -- it grows to the largest range
+// partitioned so far and is never given back
+template <typename It, typename P>
+auto stable_partition_with(It first, It last, P predicate) -> It {
+  using T = typename std::iterator_traits<It>::value_type;
+  thread_local std::vector<T> pool;
+  return stable_partition_with(first, last, predicate, pool);
+}
+
+// The same as in 2.6, but without the allocations
+// std::stable_partition makes on every call
+template <typename It>
+void move_selected_to(It first, It last, It destination) {
+  stable_partition_with(first, destination, is_not_selected);
+  stable_partition_with(destination, last, is_selected);
+}
+
+template <typename It>
+void std_move_selected_to(It first, It last, It destination) {
+  std::stable_partition(first, destination, is_not_selected);
+  std::stable_partition(destination, last, is_selected);
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<list_item_t> people{{"David", true},   {"Jane", false},
+                                  {"Martha", false}, {"Peter", false},
+                                  {"Rose", true},    {"Tom", true}};
+
+  move_selected_to(people.begin(), people.end(), people.begin() + 3);
+  for (const auto &person : people) {
+    std::cout << title(person) << '\n';
+  }
+
+  // Some tests -- the result needs to be the same as the one
+  // we get from std::stable_partition
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  std::vector<list_item_t> items(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    items[i] = {std::to_string(i), i % 7 == 0 || i % 11 == 0};
+  }
+  auto expected = items;
+  std_move_selected_to(expected.begin(), expected.end(),
+                       expected.begin() + size / 2);
+
+  for (unsigned int threads : {1u, 2u, 4u, 8u}) {
+    auto actual = items;
+    std::vector<list_item_t> buffer;
+    stable_partition_with(actual.begin(), actual.begin() + size / 2,
+                          is_not_selected, buffer, threads);
+    stable_partition_with(actual.begin() + size / 2, actual.end(),
+                          is_selected, buffer, threads);
+    if (actual != expected)
+      throw;
+  }
+
+  // Benchmark, moving the selection back and forth
+  auto xs = items;
+  const auto std_time = measure([&] {
+    for (int i = 0; i < 10; ++i) {
+      std_move_selected_to(xs.begin(), xs.end(),
+                           xs.begin() + (i % 2 ? size / 4 : 3 * size / 4));
+    }
+  });
+
+  auto ys = items;
+  const auto pooled_time = measure([&] {
+    for (int i = 0; i < 10; ++i) {
+      move_selected_to(ys.begin(), ys.end(),
+                       ys.begin() + (i % 2 ? size / 4 : 3 * size / 4));
+    }
+  });
+
+  if (xs != ys)
+    throw;
+
+  std::cout << "std::stable_partition:  " << std_time << "ms\n"
+            << "stable_partition_with:  " << pooled_time << "ms\n";
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "selection_list.h"
+
+// The O(n) version from section 2.2.4
+template <typename It>
+void move_selected_to(It first, It last, It destination) {
+  std::stable_partition(first, destination, is_not_selected);
+  std::stable_partition(destination, last, is_selected);
+}
+
+auto to_vector(const selection_list &list) -> std::vector<list_item_t> {
+  std::vector<list_item_t> result;
+  result.reserve(list.size());
+  list.for_each([&result](const list_item_t &item) { result.push_back(item); });
+  return result;
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+  selection_list people{{"David", true},   {"Jane", false},
+                        {"Martha", false}, {"Peter", false},
+                        {"Rose", true},    {"Tom", true}};
+
+  people.move_selected_to(3);
+  people.for_each(
+      [](const list_item_t &person) { std::cout << title(person) << '\n'; });
+
+  // Some tests -- dragging random selections around needs to give
+  // the same result as the std::stable_partition based version
+  std::mt19937 random;
+  {
+    std::vector<list_item_t> expected;
+    selection_list actual;
+    for (int i = 0; i < 1000; ++i) {
+      expected.emplace_back(std::to_string(i), false);
+      actual.push_back(expected.back());
+    }
+
+    for (int drag = 0; drag < 100; ++drag) {
+      for (int i = 0; i < 10; ++i) {
+        const auto index = random() % expected.size();
+        const bool selected = random() % 2;
+        expected[index].second = selected;
+        actual.set_selected(index, selected);
+      }
+      const auto destination = random() % (expected.size() + 1);
+      move_selected_to(expected.begin(), expected.end(),
+                       expected.begin() + destination);
+      actual.move_selected_to(destination);
+
+      if (to_vector(actual) != expected)
+        throw;
+    }
+  }
+
+  // Benchmark, dragging k selected items within n rows
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const std::size_t k = 16;
+  const int drags = 100;
+
+  std::vector<list_item_t> rows;
+  selection_list list;
+  for (std::size_t i = 0; i < size; ++i) {
+    rows.emplace_back(std::to_string(i), false);
+    list.push_back(rows.back());
+  }
+  for (std::size_t i = 0; i < k; ++i) {
+    const auto index = random() % size;
+    rows[index].second = true;
+    list.set_selected(index, true);
+  }
+
+  std::vector<std::size_t> destinations(drags);
+  for (auto &destination : destinations) {
+    destination = random() % size;
+  }
+
+  const auto vector_time = measure([&] {
+    for (const auto destination : destinations) {
+      move_selected_to(rows.begin(), rows.end(), rows.begin() + destination);
+    }
+  });
+
+  const auto tree_time = measure([&] {
+    for (const auto destination : destinations) {
+      list.move_selected_to(destination);
+    }
+  });
+
+  if (to_vector(list) != rows)
+    throw;
+
+  std::cout << drags << " drags of " << list.selected_count() << " items in "
+            << size << " rows\n"
+            << "std::vector:     " << vector_time << "ms\n"
+            << "selection_list:  " << tree_time << "ms\n";
+}
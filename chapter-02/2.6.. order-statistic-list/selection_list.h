@@ -0,0 +1,232 @@
+#ifndef SELECTION_LIST_H
+#define SELECTION_LIST_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+typedef std::pair<std::string, bool> list_item_t;
+
+inline std::string title(const list_item_t &item) {
+  return item.first + std::string(static_cast<size_t>(item.second), '*');
+}
+
+inline bool is_selected(const list_item_t &item) { return item.second; }
+
+inline bool is_not_selected(const list_item_t &item) { return !item.second; }
+
+// A list of items backed by an implicit treap -- a randomized balanced
+// binary tree where the position of an item is not stored anywhere,
+// but implied by the sizes of the subtrees to its left.
+//
+// Accessing an item by its position is O(log n) instead of O(1),
+// but an item can be taken out of the list or inserted anywhere
+// in O(log n). The list keeps track of the selected items, so
+// gathering k of them at a destination costs O(k log n) instead
+// of the O(n) that move_selected_to from section 2.2.4 needs.
+class selection_list {
+public:
+  selection_list() = default;
+
+  selection_list(std::initializer_list<list_item_t> items) {
+    for (const auto &item : items) {
+      push_back(item);
+    }
+  }
+
+  selection_list(const selection_list &) = delete;
+  selection_list &operator=(const selection_list &) = delete;
+
+  std::size_t size() const { return size_of(m_root); }
+
+  bool empty() const { return m_root == nullptr; }
+
+  std::size_t selected_count() const { return m_selected.size(); }
+
+  // O(log n)
+  void push_back(list_item_t item) {
+    m_nodes.push_back({std::move(item), m_random(), 1});
+    auto node = &m_nodes.back();
+    if (is_selected(node->item)) {
+      m_selected.insert(node);
+    }
+    m_root = merge(m_root, node);
+    m_root->parent = nullptr;
+  }
+
+  // O(log n)
+  const list_item_t &operator[](std::size_t index) const {
+    return node_at(index)->item;
+  }
+
+  // Items need to be (de)selected through the list, so that
+  // it can keep track of them. O(log n)
+  void set_selected(std::size_t index, bool selected) {
+    auto node = node_at(index);
+    node->item.second = selected;
+    if (selected) {
+      m_selected.insert(node);
+    } else {
+      m_selected.erase(node);
+    }
+  }
+
+  // Groups the selected items and moves them to the desired location.
+  // The result is the same as the one of move_selected_to
+  // from section 2.2.4: the items that are not selected keep their
+  // order and the number of them that is before the destination.
+  // O(k log n) for k selected items
+  void move_selected_to(std::size_t destination) {
+    if (m_selected.empty()) {
+      return;
+    }
+
+    // Finding where the selected items are, and sorting them
+    // so that they keep their relative order. O(k log n + k log k)
+    std::vector<std::pair<std::size_t, node_t *>> selected;
+    selected.reserve(m_selected.size());
+    for (auto node : m_selected) {
+      selected.emplace_back(index_of(node), node);
+    }
+    std::sort(selected.begin(), selected.end());
+
+    // Taking the selected items out of the tree, starting from the
+    // last one so that the positions of the others stay valid
+    std::size_t before_destination = 0;
+    for (auto it = selected.rbegin(); it != selected.rend(); ++it) {
+      if (it->first < destination) {
+        ++before_destination;
+      }
+      node_t *left, *rest, *node, *right;
+      split(m_root, it->first, left, rest);
+      split(rest, 1, node, right);
+      m_root = merge(left, right);
+    }
+
+    node_t *block = nullptr;
+    for (const auto &entry : selected) {
+      auto node = entry.second;
+      node->left = node->right = node->parent = nullptr;
+      node->size = 1;
+      block = merge(block, node);
+    }
+
+    node_t *left, *right;
+    split(m_root, destination - before_destination, left, right);
+    m_root = merge(merge(left, block), right);
+    m_root->parent = nullptr;
+  }
+
+  // Visits the items in order. O(n)
+  template <typename F> void for_each(F f) const { for_each(m_root, f); }
+
+private:
+  struct node_t {
+    list_item_t item;
+    std::mt19937::result_type priority;
+    std::size_t size;
+    node_t *left = nullptr;
+    node_t *right = nullptr;
+    node_t *parent = nullptr;
+  };
+
+  static std::size_t size_of(const node_t *node) {
+    return node ? node->size : 0;
+  }
+
+  static void update(node_t *node) {
+    node->size = 1 + size_of(node->left) + size_of(node->right);
+    if (node->left) {
+      node->left->parent = node;
+    }
+    if (node->right) {
+      node->right->parent = node;
+    }
+  }
+
+  // Splits the tree into the first `count` items and the rest
+  static void split(node_t *node, std::size_t count, node_t *&left,
+                    node_t *&right) {
+    if (!node) {
+      left = right = nullptr;
+    } else if (size_of(node->left) < count) {
+      split(node->right, count - size_of(node->left) - 1, node->right,
+            right);
+      left = node;
+      update(node);
+    } else {
+      split(node->left, count, left, node->left);
+      right = node;
+      update(node);
+    }
+    if (left) {
+      left->parent = nullptr;
+    }
+    if (right) {
+      right->parent = nullptr;
+    }
+  }
+
+  // Concatenates two trees, keeping the heap order of priorities
+  static node_t *merge(node_t *left, node_t *right) {
+    if (!left || !right) {
+      return left ? left : right;
+    }
+    if (left->priority > right->priority) {
+      left->right = merge(left->right, right);
+      update(left);
+      return left;
+    } else {
+      right->left = merge(left, right->left);
+      update(right);
+      return right;
+    }
+  }
+
+  node_t *node_at(std::size_t index) const {
+    auto node = m_root;
+    while (index != size_of(node->left)) {
+      if (index < size_of(node->left)) {
+        node = node->left;
+      } else {
+        index -= size_of(node->left) + 1;
+        node = node->right;
+      }
+    }
+    return node;
+  }
+
+  // Walks from the node to the root summing up the sizes
+  // of the subtrees that are to the left of it
+  static std::size_t index_of(const node_t *node) {
+    auto index = size_of(node->left);
+    for (; node->parent; node = node->parent) {
+      if (node->parent->right == node) {
+        index += size_of(node->parent->left) + 1;
+      }
+    }
+    return index;
+  }
+
+  template <typename F> static void for_each(const node_t *node, F &f) {
+    if (node) {
+      for_each(node->left, f);
+      f(node->item);
+      for_each(node->right, f);
+    }
+  }
+
+  // std::deque never moves its elements, so the nodes can
+  // point to each other
+  std::deque<node_t> m_nodes;
+  node_t *m_root = nullptr;
+  std::unordered_set<node_t *> m_selected;
+  std::mt19937 m_random;
+};
+
+#endif // SELECTION_LIST_H
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "person.h"
+#include "random_people.h"
+
+// Counting every heap allocation the program makes
+// by replacing the global operator new
+static std::atomic<std::size_t> allocations{0};
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (auto pointer = std::malloc(size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+template <typename F> auto count_allocations(F &&f) -> std::size_t {
+  const auto before = allocations.load();
+  f();
+  return allocations.load() - before;
+}
+
+// Emulates the previous person_t accessors
+// which returned the names by value
+auto surname_copy(const person_t &person) -> std::string {
+  return person.surname();
+}
+
+auto is_female(const person_t &person) -> bool {
+  return person.gender() == person_t::female;
+}
+
+auto main(int argc, char *argv[]) -> int {
+  const auto people = random_people(argc > 1 ? std::atoi(argv[1]) : 100000);
+
+  std::vector<person_t> females;
+  std::copy_if(people.cbegin(), people.cend(), std::back_inserter(females),
+               is_female);
+
+  // Filtering by name (as company_t::team_name_for in 3.3 does)
+  // creates a temporary string for every person when the accessor
+  // returns by value. Names that do not fit into the small string
+  // buffer, like some of the generated surnames, need to be
+  // allocated on the heap.
+  std::size_t count = 0;
+  const auto by_value_filter = count_allocations([&] {
+    count = std::count_if(
+        females.cbegin(), females.cend(), [](const person_t &person) {
+          return surname_copy(person) == "Featherstonehaugh";
+        });
+  });
+
+  std::size_t ref_count = 0;
+  const auto by_ref_filter = count_allocations([&] {
+    ref_count = std::count_if(
+        females.cbegin(), females.cend(), [](const person_t &person) {
+          return person.surname() == "Featherstonehaugh";
+        });
+  });
+
+  if (count != ref_count)
+    throw;
+
+  // Transforming to get the names (section 2.2.5). When the names
+  // are only needed for reading, views are enough.
+  const auto by_value_transform = count_allocations([&] {
+    std::vector<std::string> names(females.size());
+    std::transform(females.cbegin(), females.cend(), names.begin(),
+                   surname_copy);
+  });
+
+  const auto view_transform = count_allocations([&] {
+    std::vector<std::string_view> names(females.size());
+    std::transform(
+        females.cbegin(), females.cend(), names.begin(),
+        [](const person_t &person) { return person.surname_view(); });
+  });
+
+  // Constructing persons from temporary strings moves them
+  // into the person instead of copying
+  const auto construction = count_allocations([&] {
+    std::vector<person_t> built;
+    built.reserve(1000);
+    for (int i = 0; i < 1000; ++i) {
+      built.emplace_back(std::string("Christopher Alexander"),
+                         person_t::male);
+    }
+  });
+
+  std::cout << "filter by surname, by-value accessor:  " << by_value_filter
+            << " allocations\n"
+            << "filter by surname, reference accessor: " << by_ref_filter
+            << " allocations\n"
+            << "transform to surnames, std::string:    " << by_value_transform
+            << " allocations\n"
+            << "transform to surnames, string_view:    " << view_transform
+            << " allocations\n"
+            << "constructing 1000 persons:             " << construction
+            << " allocations\n";
+
+  // some tests
+  if (by_ref_filter != 0)
+    throw;
+  if (view_transform != 1)
+    throw;
+  // One for the vector, one for every name
+  if (construction != 1001)
+    throw;
+
+  return 0;
+}
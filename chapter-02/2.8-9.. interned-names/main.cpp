@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "name_pool.h"
+#include "person.h"
+#include "random_people.h"
+
+// A person whose name and surname are interned. Comparing names
+// compares the ids, and the person takes 16 bytes instead of
+// two std::string objects and the heap memory they own.
+struct interned_person_t {
+  name_pool::id_t name;
+  name_pool::id_t surname;
+  person_t::gender_t gender;
+  int age;
+};
+
+static_assert(sizeof(interned_person_t) == 16,
+              "the comment above needs to be updated");
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Interns the names of the people on several threads at once,
+// every thread handles its own part of the collection
+auto intern_people(name_pool &pool, const std::vector<person_t> &people,
+                   unsigned int threads) -> std::vector<interned_person_t> {
+  threads = std::max(1u, threads);
+  std::vector<interned_person_t> result(people.size());
+  const auto chunk_size = (people.size() + threads - 1) / threads;
+
+  std::vector<std::thread> workers;
+  for (unsigned int thread = 0; thread < threads; ++thread) {
+    workers.emplace_back([&, thread] {
+      const auto first = std::min(people.size(), thread * chunk_size);
+      const auto last = std::min(people.size(), first + chunk_size);
+      for (auto i = first; i < last; ++i) {
+        const auto &person = people[i];
+        result[i] = {pool.intern(person.name()), pool.intern(person.surname()),
+                     person.gender(), person.age()};
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  return result;
+}
+
+// The memory a std::string takes, including the heap buffer
+// when the string does not fit into the small string buffer
+auto string_memory(const std::string &value) -> std::size_t {
+  return sizeof(std::string) +
+         (value.capacity() > std::string().capacity() ? value.capacity() + 1
+                                                      : 0);
+}
+
+auto main(int argc, char *argv[]) -> int {
+  const auto people = random_people(argc > 1 ? std::atoi(argv[1]) : 1000000);
+  const auto threads = argc > 2 ? std::max(1, std::atoi(argv[2])) : 4;
+
+  name_pool pool;
+  std::vector<interned_person_t> interned;
+  const auto intern_time =
+      measure([&] { interned = intern_people(pool, people, threads); });
+
+  // some tests
+  std::set<std::string> distinct;
+  for (std::size_t i = 0; i < people.size(); ++i) {
+    distinct.insert(people[i].name());
+    distinct.insert(people[i].surname());
+    if (pool[interned[i].name] != people[i].name() ||
+        pool[interned[i].surname] != people[i].surname())
+      throw;
+  }
+  if (pool.size() != distinct.size())
+    throw;
+  for (std::size_t i = 1; i < people.size(); ++i) {
+    if ((interned[i].surname == interned[0].surname) !=
+        (people[i].surname() == people[0].surname()))
+      throw;
+  }
+  if (pool.find("Nobody") || !pool.find("Featherstonehaugh"))
+    throw;
+
+  // Counting the persons with a given surname
+  std::size_t string_count = 0;
+  const auto string_time = measure([&] {
+    string_count = std::count_if(
+        people.cbegin(), people.cend(), [](const person_t &person) {
+          return person.surname() == "Featherstonehaugh";
+        });
+  });
+
+  std::size_t id_count = 0;
+  const auto id_time = measure([&] {
+    const auto surname = *pool.find("Featherstonehaugh");
+    id_count = std::count_if(interned.cbegin(), interned.cend(),
+                             [surname](const interned_person_t &person) {
+                               return person.surname == surname;
+                             });
+  });
+
+  if (string_count != id_count)
+    throw;
+
+  std::size_t strings_memory = 0;
+  for (const auto &person : people) {
+    strings_memory +=
+        string_memory(person.name()) + string_memory(person.surname());
+  }
+  const auto interned_memory =
+      2 * sizeof(name_pool::id_t) * interned.size() + pool.characters_size();
+
+  std::cout << "interning " << people.size() << " persons on " << threads
+            << " threads: " << intern_time << "ms\n"
+            << "comparing surnames as strings: " << string_time << "ms\n"
+            << "comparing surnames as ids:     " << id_time << "ms\n"
+            << "memory for the names:\n"
+            << "  std::string: " << strings_memory << " bytes\n"
+            << "  interned:    " << interned_memory << " bytes\n";
+}
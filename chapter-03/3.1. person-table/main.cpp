@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "person.h"
+#include "person_table.h"
+#include "random_people.h"
+
+// The generic function object from 3.1 -- since it only calls .age(),
+// it works both with person_t and with the person_view rows
+// of a person_table
+class older_than {
+public:
+  older_than(int limit) : m_limit(limit) {}
+
+  template <typename T> bool operator()(T &&object) const {
+    return std::forward<T>(object).age() > m_limit;
+  }
+
+private:
+  int m_limit;
+};
+
+auto is_female(const person_view &person) -> bool {
+  return person.gender() == person_t::female;
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<person_t> small{
+      {"David", person_t::male, 50},    {"Jane", person_t::female, 30},
+      {"Martha", person_t::female, 45}, {"Peter", person_t::male, 20},
+      {"Rose", person_t::female, 60},   {"Tom", person_t::male, 42}};
+
+  person_table table(small);
+
+  for (auto index : select_older_than(table, 42)) {
+    table[index].print(std::cout, person_t::full_name);
+  }
+
+  // some tests
+  if (table.size() != small.size())
+    throw;
+  if (table[2].name() != "Martha" || table[2].surname() != "Doe" ||
+      table[2].age() != 45 || table[2].gender() != person_t::female)
+    throw;
+  if (std::count_if(cbegin(table), cend(table), older_than(42)) != 3)
+    throw;
+  if (count_older_than(table, 42) != 3)
+    throw;
+  if (count_of_gender(table, person_t::female) != 3)
+    throw;
+  if (select_of_gender(table, person_t::male) !=
+      std::vector<std::uint32_t>{0, 3, 5})
+    throw;
+  if (!(cbegin(table) < cend(table)) || !(cend(table) > cbegin(table)) ||
+      !(cbegin(table) <= cbegin(table)) || !(cend(table) >= cbegin(table)) ||
+      (*(2 + cbegin(table))).name() != "Martha")
+    throw;
+
+  // Benchmark
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const auto people = random_people(size);
+  const person_table people_table(people);
+
+  std::size_t vector_count = 0;
+  std::size_t table_count = 0;
+  std::size_t column_count = 0;
+
+  const auto vector_time = measure([&] {
+    vector_count = std::count_if(cbegin(people), cend(people), older_than(42));
+  });
+  const auto table_time = measure([&] {
+    table_count = std::count_if(cbegin(people_table), cend(people_table),
+                                older_than(42));
+  });
+  const auto column_time =
+      measure([&] { column_count = count_older_than(people_table, 42); });
+
+  if (vector_count != table_count || vector_count != column_count)
+    throw;
+
+  const auto females = std::count_if(cbegin(people_table), cend(people_table),
+                                     is_female);
+  if (static_cast<std::size_t>(females) !=
+      count_of_gender(people_table, person_t::female))
+    throw;
+
+  std::cout << "count_if over std::vector<person_t>:  " << vector_time
+            << "ms\n"
+            << "count_if over person_table rows:     " << table_time << "ms\n"
+            << "count_older_than over the age column: " << column_time
+            << "ms\n";
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "person.h"
+#include "person_index.h"
+#include "random_people.h"
+#include "roaring.h"
+
+// The generic function object from 3.1
+class older_than {
+public:
+  older_than(int limit) : m_limit(limit) {}
+
+  template <typename T> bool operator()(T &&object) const {
+    return std::forward<T>(object).age() > m_limit;
+  }
+
+private:
+  int m_limit;
+};
+
+auto is_female(const person_t &person) -> bool {
+  return person.gender() == person_t::female;
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Checks the bitmap operations against std::set
+void test_roaring_bitmap() {
+  std::mt19937 random;
+  for (std::uint32_t range : {100u, 10000u, 200000u}) {
+    for (std::size_t count : {10u, 5000u, 100000u}) {
+      std::set<std::uint32_t> left_set, right_set;
+      roaring_bitmap left, right;
+      for (std::size_t i = 0; i < count; ++i) {
+        const auto l = random() % range;
+        const auto r = random() % range;
+        left_set.insert(l);
+        left.add(l);
+        right_set.insert(r);
+        right.add(r);
+      }
+
+      std::vector<std::uint32_t> expected;
+      std::set_intersection(left_set.begin(), left_set.end(),
+                            right_set.begin(), right_set.end(),
+                            std::back_inserter(expected));
+      if ((left & right).to_vector() != expected)
+        throw;
+      if (roaring_bitmap::and_cardinality(left, right) != expected.size())
+        throw;
+
+      expected.clear();
+      std::set_union(left_set.begin(), left_set.end(), right_set.begin(),
+                     right_set.end(), std::back_inserter(expected));
+      if ((left | right).to_vector() != expected)
+        throw;
+      if (roaring_bitmap::or_cardinality(left, right) != expected.size())
+        throw;
+
+      expected.clear();
+      std::set_difference(left_set.begin(), left_set.end(),
+                          right_set.begin(), right_set.end(),
+                          std::back_inserter(expected));
+      if ((left - right).to_vector() != expected)
+        throw;
+
+      for (auto value : right_set) {
+        left.remove(value);
+        left_set.erase(value);
+      }
+      if (left.to_vector() !=
+          std::vector<std::uint32_t>(left_set.begin(), left_set.end()))
+        throw;
+    }
+  }
+
+  // Uniting many bitmaps at once, sparse and dense ones
+  {
+    std::set<std::uint32_t> expected;
+    std::vector<roaring_bitmap> bitmaps(20);
+    for (std::size_t i = 0; i < bitmaps.size(); ++i) {
+      const std::size_t count = i % 2 ? 10 : 10000;
+      for (std::size_t j = 0; j < count; ++j) {
+        const auto value = random() % 200000;
+        bitmaps[i].add(value);
+        expected.insert(value);
+      }
+    }
+    if (roaring_bitmap::unite_all(bitmaps.cbegin(), bitmaps.cend())
+            .to_vector() !=
+        std::vector<std::uint32_t>(expected.begin(), expected.end()))
+      throw;
+    if (!roaring_bitmap::unite_all(bitmaps.cbegin(), bitmaps.cbegin())
+             .empty())
+      throw;
+  }
+
+  if (roaring_bitmap::range(70000).cardinality() != 70000)
+    throw;
+  if (roaring_bitmap::range(70000).contains(70000))
+    throw;
+}
+
+int main(int argc, char *argv[]) {
+  test_roaring_bitmap();
+
+  std::vector<person_t> people{
+      {"David", person_t::male, 50},    {"Jane", person_t::female, 30},
+      {"Martha", person_t::female, 45}, {"Peter", person_t::male, 20},
+      {"Rose", person_t::female, 60},   {"Tom", person_t::male, 42}};
+
+  person_index index(people);
+
+  // Females older than 42
+  (index.of_gender(person_t::female) & index.older_than(42))
+      .for_each([&people](std::uint32_t id) {
+        people[id].print(std::cout, person_t::name_only);
+      });
+
+  // some tests
+  if (index.older_than(42).cardinality() != 3)
+    throw;
+  if (index.complement(index.of_gender(person_t::female)).to_vector() !=
+      std::vector<std::uint32_t>{0, 3, 5})
+    throw;
+  if ((index.of_gender(person_t::male) | index.younger_than(31)).cardinality() !=
+      4)
+    throw;
+
+  // The index is maintained when persons come and go
+  index.remove(4, people[4]);
+  if ((index.of_gender(person_t::female) & index.older_than(42))
+          .cardinality() != 1)
+    throw;
+  people.push_back({"Anna", person_t::female, 70});
+  index.insert(6, people[6]);
+  if ((index.of_gender(person_t::female) & index.older_than(42))
+          .to_vector() != std::vector<std::uint32_t>{2, 6})
+    throw;
+
+  // Benchmark
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const auto population = random_people(size);
+
+  person_index population_index;
+  const auto build_time =
+      measure([&] { population_index = person_index(population); });
+
+  std::size_t scan_count = 0;
+  std::size_t index_count = 0;
+
+  const auto scan_time = measure([&] {
+    scan_count = std::count_if(
+        population.cbegin(), population.cend(), [](const person_t &person) {
+          return is_female(person) && older_than(42)(person);
+        });
+  });
+
+  const auto index_time = measure([&] {
+    const auto older = population_index.older_than(42);
+    index_count = roaring_bitmap::and_cardinality(
+        population_index.of_gender(person_t::female), older);
+  });
+
+  if (scan_count != index_count)
+    throw;
+  if (population_index.count_age_between(43, person_index::max_age) !=
+      static_cast<std::size_t>(std::count_if(
+          population.cbegin(), population.cend(), older_than(42))))
+    throw;
+
+  std::cout << "building the index:             " << build_time << "ms\n"
+            << "count_if female && older_than:  " << scan_time << "ms\n"
+            << "bitmap older_than, and:         " << index_time << "ms\n";
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "person.h"
+#include "person_file.h"
+#include "random_people.h"
+
+// The generic function object from 3.1
+class older_than {
+public:
+  older_than(int limit) : m_limit(limit) {}
+
+  template <typename T> bool operator()(T &&object) const {
+    return std::forward<T>(object).age() > m_limit;
+  }
+
+private:
+  int m_limit;
+};
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+  // The pid keeps concurrent runs from writing the same file
+  const auto path = (std::filesystem::temp_directory_path() /
+                     ("people-" + std::to_string(::getpid()) + ".fpcpp"))
+                        .string();
+
+  const std::vector<person_t> people{
+      {"David", person_t::male, 50},    {"Jane", person_t::female, 30},
+      {"Martha", person_t::female, 45}, {"Peter", person_t::male, 20},
+      {"Rose", person_t::female, 60},   {"Tom", "Smith", person_t::male, 42}};
+
+  write_person_file(path, people);
+  {
+    const mapped_person_file file(path);
+    for (const auto &person : file) {
+      person.print(std::cout, person_t::full_name);
+    }
+
+    // some tests
+    if (file.size() != people.size())
+      throw;
+    for (std::size_t i = 0; i < people.size(); ++i) {
+      if (file[i].name() != people[i].name() ||
+          file[i].surname() != people[i].surname() ||
+          file[i].gender() != people[i].gender() ||
+          file[i].age() != people[i].age())
+        throw;
+    }
+    if (std::count_if(cbegin(file), cend(file), older_than(42)) != 3)
+      throw;
+  }
+
+  // Corrupt files are rejected, instead of giving out views
+  // outside of the mapping
+  auto overwrite = [&path](std::size_t offset, std::uint64_t value,
+                           std::size_t size) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(&value), size);
+  };
+  auto rejected = [](auto f) {
+    try {
+      f();
+    } catch (const std::runtime_error &) {
+      return true;
+    }
+    return false;
+  };
+
+  overwrite(offsetof(person_file_header, row_count), std::uint64_t(1) << 61,
+            sizeof(std::uint64_t));
+  if (!rejected([&] { mapped_person_file file(path); }))
+    throw;
+
+  write_person_file(path, people);
+  overwrite(sizeof(person_file_header) + sizeof(person_file_row) +
+                offsetof(person_file_row, name_offset),
+            UINT32_MAX - 2, sizeof(std::uint32_t));
+  {
+    const mapped_person_file file(path);
+    if (file[0].name() != "David" || !rejected([&] { file[1].name(); }))
+      throw;
+  }
+
+  // Benchmark, loading the population into memory
+  // versus mapping the file
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const auto population = random_people(size);
+  const auto convert_time =
+      measure([&] { write_person_file(path, population); });
+
+  std::vector<person_t> loaded;
+  const auto load_time = measure([&] {
+    const mapped_person_file file(path);
+    loaded.reserve(file.size());
+    for (const auto &person : file) {
+      loaded.push_back(person.to_person());
+    }
+  });
+
+  std::size_t mapped_count = 0;
+  const auto map_time = measure([&] {
+    const mapped_person_file file(path);
+    mapped_count = file.size();
+  });
+
+  const mapped_person_file file(path);
+  std::size_t count = 0;
+  const auto query_time = measure([&] {
+    count = std::count_if(cbegin(file), cend(file), older_than(42));
+  });
+
+  if (mapped_count != population.size() ||
+      count != static_cast<std::size_t>(std::count_if(
+                   population.cbegin(), population.cend(), older_than(42))))
+    throw;
+
+  // Worker processes map the same file, and share its pages
+  const auto worker = fork();
+  if (worker == 0) {
+    const mapped_person_file shared(path);
+    const auto worker_count = static_cast<std::size_t>(
+        std::count_if(cbegin(shared), cend(shared), older_than(42)));
+    std::_Exit(worker_count == count ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  int status = 0;
+  waitpid(worker, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+    throw;
+
+  std::filesystem::remove(path);
+
+  std::cout << "converting " << size << " persons:     " << convert_time
+            << "ms\n"
+            << "loading into std::vector<person_t>: " << load_time << "ms\n"
+            << "mapping the file:                   " << map_time << "ms\n"
+            << "count_if older_than in place:       " << query_time << "ms\n";
+}
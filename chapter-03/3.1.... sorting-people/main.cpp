@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "person.h"
+#include "person_sort.h"
+#include "person_table.h"
+#include "random_people.h"
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// The usual way to sort by several keys
+auto by_age_surname_name(const person_t &left, const person_t &right)
+    -> bool {
+  return std::forward_as_tuple(left.age(), left.surname(), left.name()) <
+         std::forward_as_tuple(right.age(), right.surname(), right.name());
+}
+
+// The expected order, computed with std::stable_sort
+template <typename Persons>
+auto stable_sorted_order(const Persons &persons) -> std::vector<std::uint32_t> {
+  std::vector<std::uint32_t> result(persons.size());
+  std::iota(result.begin(), result.end(), 0);
+  std::stable_sort(result.begin(), result.end(),
+                   [&](std::uint32_t left, std::uint32_t right) {
+                     return by_age_surname_name(persons[left], persons[right]);
+                   });
+  return result;
+}
+
+auto main(int argc, char *argv[]) -> int {
+  const std::vector<person_t> people{
+      {"Rose", "Smith", person_t::female, 30},
+      {"David", "Smith", person_t::male, 30},
+      {"Jane", "Featherstonehaugh", person_t::female, 45},
+      {"Peter", "Featherstonehaug", person_t::male, 45},
+      {"Tom", "Smith", person_t::male, 20},
+      {"Martha", "Featherstonehaugh", person_t::female, 45},
+      {"David", "Smith", person_t::other, 30}};
+
+  for (auto index : sorted_order(people)) {
+    std::cout << people[index].age() << ' ';
+    people[index].print(std::cout, person_t::full_name);
+  }
+
+  // some tests
+  if (sorted_order(people) != std::vector<std::uint32_t>{4, 1, 6, 0, 3, 2, 5})
+    throw;
+  if (!sorted_order(std::vector<person_t>{}).empty())
+    throw;
+
+  // Ages outside of the range the counting sort handles
+  const std::vector<person_t> ancient{{"Adam", person_t::male, 930},
+                                      {"Eve", person_t::female, -100000},
+                                      {"Seth", person_t::male, 912}};
+  if (sorted_order(ancient) != std::vector<std::uint32_t>{1, 2, 0})
+    throw;
+
+  // Benchmark
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const auto population = random_people(size);
+  const person_table table(population);
+  const auto threads = std::max(1u, std::thread::hardware_concurrency());
+
+  auto sorted_people = population;
+  const auto std_sort_time = measure([&] {
+    std::stable_sort(sorted_people.begin(), sorted_people.end(),
+                     by_age_surname_name);
+  });
+
+  std::vector<std::uint32_t> vector_order;
+  const auto vector_time =
+      measure([&] { vector_order = sorted_order(population, threads); });
+
+  std::vector<std::uint32_t> table_order;
+  const auto table_time =
+      measure([&] { table_order = sorted_order(table, threads); });
+
+  if (vector_order != table_order)
+    throw;
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto &person = population[vector_order[i]];
+    if (person.name() != sorted_people[i].name() ||
+        person.surname() != sorted_people[i].surname() ||
+        person.gender() != sorted_people[i].gender() ||
+        person.age() != sorted_people[i].age())
+      throw;
+  }
+
+  // The results do not depend on the number of threads
+  if (size <= 1000000) {
+    for (unsigned int test_threads : {1u, 3u, 8u}) {
+      if (sorted_order(table, test_threads) != vector_order)
+        throw;
+    }
+    if (stable_sorted_order(population) != vector_order)
+      throw;
+  }
+
+  std::cout << "sorting " << size << " persons by (age, surname, name)\n"
+            << "std::stable_sort std::vector<person_t>: " << std_sort_time
+            << "ms\n"
+            << "sorted_order std::vector<person_t>:     " << vector_time
+            << "ms\n"
+            << "sorted_order person_table:              " << table_time
+            << "ms\n";
+}
@@ -1,48 +1,461 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "person.h"
+#include "person_index.h"
+#include "roaring.h"
 
 // See section 3.2.2
+//
+// The company keeps an index from member names to their teams, and
+// statistics of every team -- the number of employees, how many of
+// them are of each gender, and the sum of their ages. These are
+// updated when a team is created and when members come and go, so
+// team_name_for, count_team_members and the other queries only need
+// to look them up, instead of searching through all the teams.
+//
+// A name is a member of at most one team. When create_team is given
+// a name which is already in another team, the name stays where it was.
+
+// Statistics of a group of employees
+struct team_stats_t {
+  int count = 0;
+  int genders[3] = {0, 0, 0};
+  long long age_sum = 0;
+
+  double average_age() const {
+    return count ? static_cast<double>(age_sum) / count : 0.0;
+  }
+
+  team_stats_t &operator+=(const team_stats_t &other) {
+    count += other.count;
+    for (int gender = 0; gender < 3; ++gender) {
+      genders[gender] += other.genders[gender];
+    }
+    age_sum += other.age_sum;
+    return *this;
+  }
+
+  team_stats_t &operator-=(const team_stats_t &other) {
+    count -= other.count;
+    for (int gender = 0; gender < 3; ++gender) {
+      genders[gender] -= other.genders[gender];
+    }
+    age_sum -= other.age_sum;
+    return *this;
+  }
+};
+
+// The employees which share a name, and therefore a team. The ids
+// are the positions of the employees in the company.
+struct employee_group_t {
+  team_stats_t stats;
+  roaring_bitmap ids;
+};
+
+// A map which is cheap to copy. The entries are divided between a fixed
+// number of buckets, and a copy of the map shares all the buckets with
+// the original. Changing a bucket which is shared with another map
+// copies it first, either map can be changed without the other one
+// seeing it. A bucket which is no longer shared is changed in place,
+// so changing the same bucket again does not copy it again.
+template <typename Key, typename Value, std::size_t BucketCount = 1024>
+class shared_map {
+public:
+  // The value of the key, or nullptr
+  const Value *find(const Key &key) const {
+    const auto &bucket = m_buckets[index_of(key)];
+    if (!bucket) {
+      return nullptr;
+    }
+    const auto entry = bucket->find(key);
+    return entry == bucket->end() ? nullptr : &entry->second;
+  }
+
+  // The value of the key to change it, or nullptr
+  Value *find_to_change(const Key &key) {
+    if (!find(key)) {
+      return nullptr;
+    }
+    return &owned_bucket(key).find(key)->second;
+  }
+
+  // Returns false if the key is already in the map
+  bool emplace(const Key &key, Value value) {
+    if (find(key)) {
+      return false;
+    }
+    owned_bucket(key).emplace(key, std::move(value));
+    return true;
+  }
+
+  // Returns false if the key was not in the map
+  bool erase(const Key &key) {
+    return find(key) && owned_bucket(key).erase(key);
+  }
+
+private:
+  using bucket_t = std::unordered_map<Key, Value>;
+
+  static std::size_t index_of(const Key &key) {
+    return std::hash<Key>{}(key) % BucketCount;
+  }
+
+  // The bucket of the key, which only this map uses
+  bucket_t &owned_bucket(const Key &key) {
+    auto &bucket = m_buckets[index_of(key)];
+    if (!bucket) {
+      bucket = std::make_shared<bucket_t>();
+    } else if (bucket.use_count() != 1) {
+      bucket = std::make_shared<bucket_t>(*bucket);
+    }
+    return *bucket;
+  }
+
+  std::array<std::shared_ptr<bucket_t>, BucketCount> m_buckets;
+};
+
+// The teams of a company at one point in time.
+//
+// The members of every team are also kept as a compressed bitmap of
+// employee ids, so the unions of teams, and the set operations between
+// teams and other sets of employees (like the ones from person_index),
+// are bitmap operations instead of comparisons of member names. Since
+// a name is in at most one team, the teams never overlap -- there is
+// nothing to intersect between two of them.
+class teams_t {
+public:
+  using employee_groups_t = std::unordered_map<std::string, employee_group_t>;
+
+  teams_t(std::shared_ptr<const employee_groups_t> employees_named)
+      : m_employees_named(std::move(employees_named)) {}
+
+  std::string team_name_for(const person_t &) const;
+  team_stats_t team_stats(const std::string &team_name) const;
+
+  // Ids of the employees in the team
+  const roaring_bitmap &team_members(const std::string &team_name) const;
+
+  // Ids of the employees in any of the teams
+  roaring_bitmap members_of_any(const std::vector<std::string> &teams) const;
+
+  void create_team(std::string, std::vector<std::string>);
+
+  // Adds the name to the team. Returns false if the team does not
+  // exist or the name is already a member of a team.
+  bool add_member(const std::string &team_name, const std::string &name);
+
+  // Removes the name from the team. Returns false if the name
+  // was not a member of the team.
+  bool remove_member(const std::string &team_name, const std::string &name);
+
+  // Moves the name from its current team to another one. Returns false
+  // if the name was not in a team or the destination does not exist.
+  bool move_member(const std::string &name, const std::string &team_name);
+
+private:
+  struct team_t {
+    team_stats_t stats;
+    roaring_bitmap members;
+  };
+
+  // Statistics and members of every team
+  shared_map<std::string, team_t> m_teams;
+  // Team of every member name
+  shared_map<std::string, std::string> m_team_for_name;
+  // The employees with every name. The employees do not change,
+  // so all the snapshots share them.
+  std::shared_ptr<const employee_groups_t> m_employees_named;
+
+  const employee_group_t &employees_named(const std::string &name) const;
+
+  // Names are usually shared by a few employees, adding and removing
+  // their ids one by one is cheaper than combining whole bitmaps
+  static void add_ids(roaring_bitmap &members, const roaring_bitmap &ids) {
+    ids.for_each([&members](std::uint32_t id) { members.add(id); });
+  }
+
+  static void remove_ids(roaring_bitmap &members, const roaring_bitmap &ids) {
+    ids.for_each([&members](std::uint32_t id) { members.remove(id); });
+  }
+};
+
+// The company publishes its teams as immutable snapshots. Readers
+// take the current snapshot and query it without locking anything,
+// and are never blocked by the writers. Writers copy the current
+// snapshot, change the copy and publish it in its place. The copy
+// shares the buckets of its maps with the snapshot, and only copies
+// the buckets of the teams and names that are changed, so a single
+// move_member copies a few small buckets, not all the teams.
+// A batch of changes made with update() copies every bucket at most
+// once, however many changes it makes to it.
+//
+// Every thread keeps the last snapshot it has read, together with its
+// version. While the version of the company does not change, reading
+// it is a single atomic load. Only after a writer publishes a new
+// snapshot do the readers need to load the shared pointer, which
+// libstdc++ protects with a small spinlock. A thread keeps at most one
+// snapshot alive this way, until it reads from any company again --
+// and an old snapshot holds on only to the buckets that were changed
+// after it.
 class company_t {
 public:
-  company_t(std::vector<person_t> employees) : m_employees(employees) {}
+  company_t(std::vector<person_t> employees);
   std::string team_name_for(const person_t &) const;
   int count_team_members(const std::string &team_name) const;
   void create_team(std::string, std::vector<std::string>);
 
+  bool add_member(const std::string &team_name, const std::string &name);
+  bool remove_member(const std::string &team_name, const std::string &name);
+  bool move_member(const std::string &name, const std::string &team_name);
+
+  int count_team_members(const std::string &team_name,
+                         person_t::gender_t gender) const;
+  double average_team_age(const std::string &team_name) const;
+  team_stats_t team_stats(const std::string &team_name) const;
+
+  // The members of teams, to combine them with other sets of employees
+  roaring_bitmap team_members(const std::string &team_name) const;
+  std::size_t count_in_any(const std::vector<std::string> &teams) const;
+
+  // Index of the employees by gender and age, with the same ids
+  // as the team members
+  const person_index &employee_index() const { return m_employee_index; }
+
+  // The current snapshot, for a series of queries which need
+  // to see the same state of the teams
+  std::shared_ptr<const teams_t> snapshot() const {
+    return std::atomic_load(&m_teams);
+  }
+
+  // Applies a batch of changes, f is called with a copy of the current
+  // teams which is published when f returns. Returns what f returns.
+  template <typename F> auto update(F f) {
+    std::lock_guard<std::mutex> lock(m_writer);
+    auto teams = std::make_shared<teams_t>(*m_teams);
+    auto publish = [&] {
+      std::atomic_store(&m_teams,
+                        std::shared_ptr<const teams_t>(std::move(teams)));
+      m_version.store(++last_version, std::memory_order_release);
+    };
+    if constexpr (std::is_void_v<decltype(f(*teams))>) {
+      f(*teams);
+      publish();
+    } else {
+      auto result = f(*teams);
+      publish();
+      return result;
+    }
+  }
+
 private:
   std::vector<person_t> m_employees;
-  std::unordered_map<std::string, std::vector<std::string>> m_teams;
+  person_index m_employee_index;
+
+  std::shared_ptr<const teams_t> m_teams;
+  std::atomic<std::uint64_t> m_version{0};
+  std::mutex m_writer;
+
+  // The versions are unique across all companies, so that a thread
+  // can not mistake the snapshot of one company for another's,
+  // even for one which was at the same address before
+  static inline std::atomic<std::uint64_t> last_version{0};
+
+  const teams_t &current() const;
 };
 
+company_t::company_t(std::vector<person_t> employees)
+    : m_employees(std::move(employees)), m_employee_index(m_employees) {
+  auto employees_named = std::make_shared<teams_t::employee_groups_t>();
+  for (std::uint32_t id = 0; id < m_employees.size(); ++id) {
+    const auto &employee = m_employees[id];
+    auto &group = (*employees_named)[employee.name()];
+    ++group.stats.count;
+    ++group.stats.genders[employee.gender()];
+    group.stats.age_sum += employee.age();
+    group.ids.add(id);
+  }
+  m_teams = std::make_shared<const teams_t>(std::move(employees_named));
+  m_version = ++last_version;
+}
+
+const teams_t &company_t::current() const {
+  thread_local struct {
+    std::uint64_t version = 0;
+    std::shared_ptr<const teams_t> teams;
+  } cache;
+
+  const auto version = m_version.load(std::memory_order_acquire);
+  if (cache.version != version) {
+    cache.teams = std::atomic_load(&m_teams);
+    cache.version = version;
+  }
+  return *cache.teams;
+}
+
 std::string company_t::team_name_for(const person_t &person) const {
-  for (const auto &[key, value] : m_teams)
-    if (std::find_if(cbegin(value), cend(value), [&person](const auto &name) {
-          return name == person.name();
-        }) != end(value))
-      return key;
-  return "";
+  return current().team_name_for(person);
 }
 
 int company_t::count_team_members(const std::string &team_name) const {
-  // Counting the number of members in the specified team
-  // using a lambda.
-  //
-  // The lambda needs to capture `this` because it needs to access
-  // the `m_employees` member variable, and it captures the
-  // `team_name` to check whether an employee belongs to that team
-  return std::count_if(cbegin(m_employees), cend(m_employees),
-                       [this, &team_name](const person_t &employee) {
-                         return team_name_for(employee) == team_name;
-                       });
+  return team_stats(team_name).count;
+}
+
+int company_t::count_team_members(const std::string &team_name,
+                                  person_t::gender_t gender) const {
+  return team_stats(team_name).genders[gender];
+}
+
+double company_t::average_team_age(const std::string &team_name) const {
+  return team_stats(team_name).average_age();
+}
+
+team_stats_t company_t::team_stats(const std::string &team_name) const {
+  return current().team_stats(team_name);
+}
+
+roaring_bitmap company_t::team_members(const std::string &team_name) const {
+  return current().team_members(team_name);
+}
+
+std::size_t
+company_t::count_in_any(const std::vector<std::string> &teams) const {
+  return current().members_of_any(teams).cardinality();
 }
 
 void company_t::create_team(std::string team_name,
                             std::vector<std::string> members) {
-  m_teams.insert({team_name, members});
+  update([&](teams_t &teams) {
+    teams.create_team(std::move(team_name), std::move(members));
+  });
+}
+
+bool company_t::add_member(const std::string &team_name,
+                           const std::string &name) {
+  return update(
+      [&](teams_t &teams) { return teams.add_member(team_name, name); });
+}
+
+bool company_t::remove_member(const std::string &team_name,
+                              const std::string &name) {
+  return update(
+      [&](teams_t &teams) { return teams.remove_member(team_name, name); });
+}
+
+bool company_t::move_member(const std::string &name,
+                            const std::string &team_name) {
+  return update(
+      [&](teams_t &teams) { return teams.move_member(name, team_name); });
+}
+
+const employee_group_t &
+teams_t::employees_named(const std::string &name) const {
+  static const employee_group_t nobody;
+  const auto group = m_employees_named->find(name);
+  return group == m_employees_named->end() ? nobody : group->second;
+}
+
+std::string teams_t::team_name_for(const person_t &person) const {
+  const auto team = m_team_for_name.find(person.name());
+  return team ? *team : "";
+}
+
+team_stats_t teams_t::team_stats(const std::string &team_name) const {
+  const auto team = m_teams.find(team_name);
+  return team ? team->stats : team_stats_t{};
+}
+
+const roaring_bitmap &
+teams_t::team_members(const std::string &team_name) const {
+  static const roaring_bitmap nobody;
+  const auto team = m_teams.find(team_name);
+  return team ? team->members : nobody;
+}
+
+roaring_bitmap
+teams_t::members_of_any(const std::vector<std::string> &teams) const {
+  roaring_bitmap result;
+  for (const auto &team_name : teams) {
+    result |= team_members(team_name);
+  }
+  return result;
+}
+
+void teams_t::create_team(std::string team_name,
+                          std::vector<std::string> members) {
+  if (!m_teams.emplace(team_name, team_t{})) {
+    return;
+  }
+  for (const auto &member : members) {
+    add_member(team_name, member);
+  }
+}
+
+bool teams_t::add_member(const std::string &team_name,
+                         const std::string &name) {
+  if (!m_teams.find(team_name) || !m_team_for_name.emplace(name, team_name)) {
+    return false;
+  }
+  const auto &group = employees_named(name);
+  auto &team = *m_teams.find_to_change(team_name);
+  team.stats += group.stats;
+  add_ids(team.members, group.ids);
+  return true;
+}
+
+bool teams_t::remove_member(const std::string &team_name,
+                            const std::string &name) {
+  const auto member = m_team_for_name.find(name);
+  if (!member || *member != team_name) {
+    return false;
+  }
+  const auto &group = employees_named(name);
+  auto &team = *m_teams.find_to_change(team_name);
+  team.stats -= group.stats;
+  remove_ids(team.members, group.ids);
+  m_team_for_name.erase(name);
+  return true;
+}
+
+bool teams_t::move_member(const std::string &name,
+                          const std::string &team_name) {
+  const auto member = m_team_for_name.find_to_change(name);
+  if (!member || !m_teams.find(team_name)) {
+    return false;
+  }
+  const auto &group = employees_named(name);
+  auto &source = *m_teams.find_to_change(*member);
+  source.stats -= group.stats;
+  remove_ids(source.members, group.ids);
+  auto &destination = *m_teams.find_to_change(team_name);
+  destination.stats += group.stats;
+  add_ids(destination.members, group.ids);
+  *member = team_name;
+  return true;
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
 }
 
 int main(int argc, char *argv[]) {
@@ -64,4 +477,254 @@ int main(int argc, char *argv[]) {
     throw;
   if (company.count_team_members("Yellow") != 0)
     throw;
+  if (company.team_name_for(p2) != "Red")
+    throw;
+
+  // The statistics follow the members
+  if (!company.move_member("Vick", "Blue") ||
+      company.count_team_members("Blue") != 2 ||
+      company.count_team_members("Blue", person_t::male) != 1 ||
+      company.count_team_members("Red") != 0 ||
+      company.team_name_for(p2) != "Blue")
+    throw;
+  if (company.add_member("Red", "Vick") || company.add_member("Pink", "Tom"))
+    throw;
+  if (!company.remove_member("Blue", "John") ||
+      company.remove_member("Blue", "John") ||
+      company.count_team_members("Blue") != 1 ||
+      company.count_team_members("Blue", person_t::other) != 0 ||
+      company.team_name_for(p1) != "")
+    throw;
+  if (!company.add_member("Green", "John") ||
+      company.team_stats("Green").count != 1 ||
+      company.average_team_age("Green") != p1.age())
+    throw;
+
+  // Snapshots do not see the later changes
+  const auto before = company.snapshot();
+  company.update([](teams_t &teams) {
+    teams.move_member("John", "Red");
+    teams.move_member("Vick", "Red");
+  });
+  if (before->team_stats("Green").count != 1 ||
+      company.count_team_members("Green") != 0 ||
+      company.count_team_members("Red") != 2)
+    throw;
+
+  // Copies of the teams do not see the changes of each other,
+  // whichever of them is changed
+  {
+    auto teams = *company.snapshot();
+    teams.move_member("John", "Green");
+    const auto copy = teams;
+    if (!teams.move_member("John", "Blue") ||
+        copy.team_name_for(p1) != "Green" ||
+        copy.team_stats("Blue").count != 0 ||
+        teams.team_name_for(p1) != "Blue" ||
+        company.team_name_for(p1) != "Red")
+      throw;
+  }
+
+  // Set operations on the team members
+  company.create_team("Everyone", {});
+  company.update([](teams_t &teams) {
+    teams.move_member("Vick", "Green");
+    teams.move_member("John", "Everyone");
+  });
+  if (company.team_members("Green").to_vector() !=
+          std::vector<std::uint32_t>{1} ||
+      company.count_in_any({"Green", "Everyone", "Yellow"}) != 2 ||
+      roaring_bitmap::and_cardinality(
+          company.team_members("Green"),
+          company.employee_index().of_gender(person_t::male)) != 1)
+    throw;
+
+  // Benchmark
+  const std::size_t employee_count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const std::size_t team_count = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+  std::vector<person_t> staff;
+  staff.reserve(employee_count);
+  for (std::size_t i = 0; i < employee_count; ++i) {
+    staff.emplace_back("Employee " + std::to_string(i),
+                       static_cast<person_t::gender_t>(i % 3), 20 + i % 45);
+  }
+
+  std::vector<std::string> team_names;
+  std::vector<std::vector<std::string>> team_members(team_count);
+  for (std::size_t team = 0; team < team_count; ++team) {
+    team_names.push_back("Team " + std::to_string(team));
+  }
+  for (std::size_t i = 0; i < employee_count; ++i) {
+    team_members[i % team_count].push_back(staff[i].name());
+  }
+
+  company_t large_company{staff};
+  const auto create_time = measure([&] {
+    large_company.update([&](teams_t &teams) {
+      for (std::size_t team = 0; team < team_count; ++team) {
+        teams.create_team(team_names[team], std::move(team_members[team]));
+      }
+    });
+  });
+
+  std::size_t found = 0;
+  const auto team_name_time = measure([&] {
+    for (const auto &employee : staff) {
+      found += large_company.team_name_for(employee).size();
+    }
+  });
+
+  std::size_t total = 0;
+  const auto count_time = measure([&] {
+    for (const auto &team_name : team_names) {
+      total += large_company.count_team_members(team_name);
+    }
+  });
+
+  if (total != employee_count || found == 0)
+    throw;
+
+  // Every employee moves to the next team
+  const auto move_time = measure([&] {
+    large_company.update([&](teams_t &teams) {
+      for (std::size_t i = 0; i < employee_count; ++i) {
+        teams.move_member(staff[i].name(), team_names[(i + 1) % team_count]);
+      }
+    });
+  });
+
+  // Single moves copy only the buckets they change, and send the
+  // employees back to the teams they were in
+  const std::size_t single_moves = std::min<std::size_t>(1000, employee_count);
+  const auto single_move_time = measure([&] {
+    for (std::size_t i = 0; i < single_moves; ++i) {
+      large_company.move_member(staff[i].name(), team_names[i % team_count]);
+      large_company.move_member(staff[i].name(),
+                                team_names[(i + 1) % team_count]);
+    }
+  });
+
+  // The first read after an update releases the previous snapshot
+  large_company.count_team_members(team_names[0]);
+
+  double age_sum = 0;
+  const auto stats_time = measure([&] {
+    for (const auto &team_name : team_names) {
+      age_sum += large_company.average_team_age(team_name) *
+                 large_company.count_team_members(team_name);
+    }
+  });
+
+  double expected_age_sum = 0;
+  for (const auto &employee : staff) {
+    expected_age_sum += employee.age();
+  }
+  // The second team now has the employees from the first one
+  if (std::abs(age_sum - expected_age_sum) > 1e-3 * expected_age_sum ||
+      large_company.team_name_for(staff[0]) != team_names[1 % team_count] ||
+      static_cast<std::size_t>(large_company.count_team_members(
+          team_names[1 % team_count])) !=
+          (employee_count + team_count - 1) / team_count)
+    throw;
+
+  // Departments of 100 teams each, and how many of their
+  // employees are older than 50
+  const std::size_t department_size = std::min<std::size_t>(100, team_count);
+  std::vector<std::vector<std::string>> departments;
+  for (std::size_t team = 0; team + department_size <= team_count;
+       team += department_size) {
+    departments.emplace_back(team_names.begin() + team,
+                             team_names.begin() + team + department_size);
+  }
+
+  std::vector<std::size_t> scan_counts;
+  const auto scan_time = measure([&] {
+    for (const auto &department : departments) {
+      const std::unordered_set<std::string> teams(department.begin(),
+                                                  department.end());
+      scan_counts.push_back(std::count_if(
+          staff.cbegin(), staff.cend(), [&](const person_t &employee) {
+            return employee.age() > 50 &&
+                   teams.count(large_company.team_name_for(employee));
+          }));
+    }
+  });
+
+  std::vector<std::size_t> bitmap_counts;
+  const auto bitmap_time = measure([&] {
+    const auto teams = large_company.snapshot();
+    const auto older = large_company.employee_index().older_than(50);
+    for (const auto &department : departments) {
+      bitmap_counts.push_back(roaring_bitmap::and_cardinality(
+          teams->members_of_any(department), older));
+    }
+  });
+
+  if (scan_counts != bitmap_counts)
+    throw;
+
+  // Readers querying the company while a writer keeps moving
+  // employees between the teams
+  const std::size_t max_readers = argc > 3 ? std::atoi(argv[3]) : 64;
+  const std::size_t queries = 100000;
+  std::vector<std::pair<std::size_t, double>> reader_times;
+  for (std::size_t readers = 1; readers <= max_readers; readers *= 2) {
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+      for (std::size_t batch = 0; !done; ++batch) {
+        large_company.update([&](teams_t &teams) {
+          for (std::size_t i = 0; i < 100; ++i) {
+            const auto employee = (batch * 100 + i) % employee_count;
+            teams.move_member(staff[employee].name(),
+                              team_names[(employee + batch) % team_count]);
+          }
+        });
+      }
+    });
+
+    std::atomic<std::size_t> counted{0};
+    const auto time = measure([&] {
+      std::vector<std::thread> threads;
+      for (std::size_t reader = 0; reader < readers; ++reader) {
+        threads.emplace_back([&, reader] {
+          std::size_t count = 0;
+          for (std::size_t query = 0; query < queries; ++query) {
+            count += large_company.count_team_members(
+                team_names[(reader + query) % team_count]);
+          }
+          counted += count;
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+    });
+
+    done = true;
+    writer.join();
+    if (counted == 0)
+      throw;
+    reader_times.emplace_back(readers, time);
+  }
+
+  std::cout << employee_count << " employees in " << team_count << " teams\n"
+            << "create_team for all teams:          " << create_time << "ms\n"
+            << "team_name_for for all employees:    " << team_name_time
+            << "ms\n"
+            << "count_team_members for all teams:   " << count_time << "ms\n"
+            << "move_member for all employees:      " << move_time << "ms\n"
+            << 2 * single_moves << " single move_member calls:      "
+            << single_move_time << "ms\n"
+            << "average_team_age for all teams:     " << stats_time << "ms\n"
+            << "employees older than 50 in each department of "
+            << department_size << " teams\n"
+            << "  scanning the employees:           " << scan_time << "ms\n"
+            << "  with the team bitmaps:            " << bitmap_time << "ms\n"
+            << queries << " count_team_members queries per reader"
+            << " during updates:\n";
+  for (const auto &[readers, time] : reader_times) {
+    std::cout << "  " << readers << " reader(s): " << time << "ms, "
+              << readers * queries / time << " queries/ms\n";
+  }
 }
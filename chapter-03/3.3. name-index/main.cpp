@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "name_index.h"
+#include "person.h"
+#include "random_people.h"
+
+// The company from 3.3, with the team members indexed by name.
+// team_name_for does not need to compare the name of the person
+// with every member of every team.
+class company_t {
+public:
+  company_t(std::vector<std::pair<std::string, std::vector<std::string>>> teams)
+      : m_teams(std::move(teams)) {
+    std::vector<name_index::entry_t> entries;
+    for (std::uint32_t team = 0; team < m_teams.size(); ++team) {
+      for (const auto &member : m_teams[team].second) {
+        entries.emplace_back(member, team);
+      }
+    }
+    m_members = name_index(std::move(entries));
+  }
+
+  std::string team_name_for(const person_t &person) const {
+    const auto teams = m_members.find(person.name());
+    return teams.empty() ? "" : m_teams[teams.front()].first;
+  }
+
+  // Names of the teams that have members whose names start with prefix
+  std::vector<std::string> teams_with_prefix(std::string_view prefix) const {
+    auto teams = m_members.find_prefix(prefix);
+    std::sort(teams.begin(), teams.end());
+    teams.erase(std::unique(teams.begin(), teams.end()), teams.end());
+
+    std::vector<std::string> result;
+    for (auto team : teams) {
+      result.push_back(m_teams[team].first);
+    }
+    return result;
+  }
+
+private:
+  std::vector<std::pair<std::string, std::vector<std::string>>> m_teams;
+  name_index m_members;
+};
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+auto linear_find(const std::vector<person_t> &people, std::string_view name)
+    -> std::vector<std::uint32_t> {
+  std::vector<std::uint32_t> result;
+  for (std::uint32_t id = 0; id < people.size(); ++id) {
+    if (people[id].name() == name) {
+      result.push_back(id);
+    }
+  }
+  return result;
+}
+
+// Checks the lookups against linear searches, with enough distinct
+// names to fill many compressed blocks
+void test_name_index() {
+  std::vector<std::string> names;
+  for (int i = 0; i < 20000; ++i) {
+    names.push_back("id" + std::to_string(i * 7 % 5000));
+  }
+  const auto index = name_index::of(
+      names, [](const std::string &name) -> std::string_view { return name; });
+  if (index.distinct_names() != 5000)
+    throw;
+
+  for (std::string_view query : {"id0", "id1", "id42", "id4999", "id5000",
+                                 "id", "i", "", "x", "id12"}) {
+    std::vector<std::uint32_t> exact, prefixed;
+    for (std::uint32_t id = 0; id < names.size(); ++id) {
+      if (names[id] == query)
+        exact.push_back(id);
+      if (std::string_view(names[id]).substr(0, query.size()) == query)
+        prefixed.push_back(id);
+    }
+    if (index.find(query) != exact)
+      throw;
+    auto found = index.find_prefix(query);
+    std::sort(found.begin(), found.end());
+    if (found != prefixed)
+      throw;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  test_name_index();
+
+  const company_t company{{{"Blue", {"John", "Jane", "Johanna"}},
+                           {"Red", {"Vick", "Martha"}},
+                           {"Green", {}}}};
+
+  std::cout << "Vick is in team "
+            << company.team_name_for({"Vick", person_t::male}) << '\n';
+  for (const auto &team : company.teams_with_prefix("J")) {
+    std::cout << "team " << team << " has a member named J...\n";
+  }
+
+  // some tests
+  if (company.team_name_for({"John", person_t::male}) != "Blue")
+    throw;
+  if (company.team_name_for({"Martha", person_t::female}) != "Red")
+    throw;
+  if (company.team_name_for({"Jo", person_t::other}) != "")
+    throw;
+  if (company.teams_with_prefix("Jo") != std::vector<std::string>{"Blue"})
+    throw;
+  if (company.teams_with_prefix("") != std::vector<std::string>{"Blue", "Red"})
+    throw;
+  if (!company.teams_with_prefix("Z").empty())
+    throw;
+
+  // Benchmark
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const auto population = random_people(size);
+  auto name_of = [](const person_t &person) -> std::string_view {
+    return person.name();
+  };
+
+  name_index sequential_index;
+  const auto sequential_build_time = measure(
+      [&] { sequential_index = name_index::of(population, name_of, 1); });
+
+  const auto threads = std::max(1u, std::thread::hardware_concurrency());
+  name_index index;
+  const auto parallel_build_time =
+      measure([&] { index = name_index::of(population, name_of, threads); });
+
+  std::vector<std::uint32_t> linear_result;
+  const auto linear_time =
+      measure([&] { linear_result = linear_find(population, "Martha"); });
+
+  std::vector<std::uint32_t> index_result;
+  const auto index_time = measure([&] { index_result = index.find("Martha"); });
+
+  if (index_result != linear_result ||
+      sequential_index.find("Martha") != linear_result)
+    throw;
+  if (index.distinct_names() != sequential_index.distinct_names())
+    throw;
+
+  // The chunks sorted by different threads are merged correctly
+  // regardless of how many threads there are
+  for (unsigned int chunks : {2u, 3u, 8u}) {
+    if (name_index::of(population, name_of, chunks).find("Martha") !=
+        linear_result)
+      throw;
+  }
+
+  // All the names starting with "Ma" -- Martha, Mary and Maximilian
+  const auto prefix_result = index.find_prefix("Ma");
+  if (prefix_result.size() !=
+      static_cast<std::size_t>(std::count_if(
+          population.cbegin(), population.cend(), [](const person_t &person) {
+            return person.name().compare(0, 2, "Ma") == 0;
+          })))
+    throw;
+
+  std::cout << "building the index of " << size << " names\n"
+            << "  on 1 thread:               " << sequential_build_time
+            << "ms\n"
+            << "  on " << threads << " thread(s):            "
+            << parallel_build_time << "ms\n"
+            << "linear search:               " << linear_time << "ms\n"
+            << "index search:                " << index_time << "ms\n"
+            << "distinct names:              " << index.distinct_names()
+            << " in " << index.names_size() << " bytes\n";
+}
@@ -1,11 +1,25 @@
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "async_sink.h"
 #include "person.h"
+#include "person_writer.h"
+#include "random_people.h"
 
 auto print_person(const person_t &person, std::ostream &out,
                   person_t::output_format_t format) -> void {
@@ -16,7 +30,108 @@ auto print_person(const person_t &person, std::ostream &out,
   }
 }
 
-auto main() -> int {
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+auto read_file(const std::string &path) -> std::string {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+// Owns a file descriptor, and closes it when it goes out of scope
+// if close() was not called -- for example, when writing has thrown
+class file_descriptor {
+public:
+  explicit file_descriptor(int fd) : m_fd(fd) {}
+
+  file_descriptor(const file_descriptor &) = delete;
+  file_descriptor &operator=(const file_descriptor &) = delete;
+
+  ~file_descriptor() {
+    if (m_fd >= 0) {
+      ::close(m_fd);
+    }
+  }
+
+  int get() const { return m_fd; }
+
+  // Closing can report errors of the writes before it, so
+  // when everything went well, the file should be closed with this
+  void close() {
+    if (::close(std::exchange(m_fd, -1)) != 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "can not close the file");
+    }
+  }
+
+private:
+  int m_fd;
+};
+
+// Writes the persons to a new file with the buffered_writer
+auto write_file(const std::string &path, const std::vector<person_t> &people,
+                person_t::output_format_t format) -> void {
+  file_descriptor file(
+      ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  if (file.get() < 0)
+    throw std::system_error(errno, std::generic_category(), path);
+  {
+    buffered_writer out(file.get());
+    write_persons(out, cbegin(people), cend(people), format);
+    out.flush();
+  }
+  file.close();
+}
+
+// Formats what print_person would print into a string which is reused
+// for all the persons, to be written to an async_sink
+auto format_person(const person_t &person, person_t::output_format_t format,
+                   std::string &record) -> std::string_view {
+  record = person.name();
+  if (format == person_t::full_name) {
+    record += ' ';
+    record += person.surname();
+  }
+  record += '\n';
+  return record;
+}
+
+// Writes the persons to the sink from several threads, every thread
+// writes its part of the collection
+auto write_in_parallel(async_sink &sink, const std::vector<person_t> &people,
+                       unsigned int threads) -> void {
+  std::vector<std::thread> writers;
+  for (unsigned int thread = 0; thread < threads; ++thread) {
+    writers.emplace_back([&, thread] {
+      std::string record;
+      for (auto i = thread; i < people.size(); i += threads) {
+        sink.write(format_person(people[i], person_t::full_name, record));
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+}
+
+auto sorted_lines(const std::string &text) -> std::vector<std::string> {
+  std::vector<std::string> result;
+  std::size_t first = 0;
+  for (auto last = text.find('\n'); last != std::string::npos;
+       first = last + 1, last = text.find('\n', first)) {
+    result.push_back(text.substr(first, last - first));
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+auto main(int argc, char *argv[]) -> int {
   using namespace std::placeholders;
 
   std::vector<person_t> people{
@@ -44,5 +159,103 @@ auto main() -> int {
     print_person(person, file, person_t::full_name);
   });
 
+  // Formatting all the persons into a buffer, and writing it at once.
+  // Everything that is in the buffer of std::cout needs to be written
+  // first, since we are writing to the same file descriptor.
+  std::cout.flush();
+  {
+    buffered_writer out(STDOUT_FILENO);
+    write_persons(out, cbegin(people), cend(people), person_t::name_only);
+    out.flush();
+  }
+
+  // Benchmark
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const auto many_people = random_people(size);
+
+  for (auto format : {person_t::name_only, person_t::full_name}) {
+    const auto bind_time = measure([&] {
+      std::ofstream out("test-bind");
+      std::for_each(cbegin(many_people), cend(many_people),
+                    std::bind(print_person, _1, std::ref(out), format));
+    });
+
+    const auto lambda_time = measure([&] {
+      std::ofstream out("test-lambda");
+      std::for_each(cbegin(many_people), cend(many_people),
+                    [&out, format](const person_t &person) {
+                      print_person(person, out, format);
+                    });
+    });
+
+    const auto buffered_time =
+        measure([&] { write_file("test-buffered", many_people, format); });
+
+    const auto expected = read_file("test-bind");
+    if (read_file("test-lambda") != expected ||
+        read_file("test-buffered") != expected)
+      throw;
+
+    std::cout << "printing " << size << " persons, "
+              << (format == person_t::name_only ? "name_only" : "full_name")
+              << '\n'
+              << "  std::bind:                   " << bind_time << "ms\n"
+              << "  lambda:                      " << lambda_time << "ms\n"
+              << "  buffered_writer:             " << buffered_time
+              << "ms\n";
+  }
+
+  // Writing the file on a background thread, the writers only copy
+  // the records into a ring buffer. The records of different threads
+  // are interleaved, but none of them is lost.
+  {
+    {
+      async_sink sink("test-async");
+      write_in_parallel(sink, many_people, 4);
+    }
+    if (sorted_lines(read_file("test-async")) !=
+        sorted_lines(read_file("test-bind")))
+      throw;
+
+    // A small buffer which drops the records that do not fit into it
+    std::size_t dropped;
+    {
+      async_sink sink("test-async", {16, overflow_policy::drop});
+      write_in_parallel(sink, many_people, 4);
+      sink.flush();
+      dropped = sink.dropped();
+    }
+    if (sorted_lines(read_file("test-async")).size() + dropped != size)
+      throw;
+
+    // The time the writing thread is blocked, and the time
+    // it takes until everything is in the file
+    const auto ofstream_time = measure([&] {
+      std::ofstream out("test-lambda");
+      std::for_each(cbegin(many_people), cend(many_people),
+                    [&out](const person_t &person) {
+                      print_person(person, out, person_t::full_name);
+                    });
+      out.flush();
+    });
+
+    async_sink sink("test-async");
+    const auto async_time =
+        measure([&] { write_in_parallel(sink, many_people, 1); });
+    const auto async_flush_time = measure([&] { sink.flush(); });
+
+    std::cout << "writing " << size << " persons to a file\n"
+              << "  std::ofstream:               " << ofstream_time << "ms\n"
+              << "  async_sink:                  " << async_time
+              << "ms, and " << async_flush_time << "ms to flush\n"
+              << "  async_sink, dropping:        " << dropped
+              << " persons dropped with a buffer of 16\n";
+  }
+
+  std::remove("test-bind");
+  std::remove("test-lambda");
+  std::remove("test-buffered");
+  std::remove("test-async");
+
   return 0;
 }
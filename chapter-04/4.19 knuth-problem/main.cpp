@@ -1,11 +1,24 @@
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "histogram.h"
+
+// count_occurences (section 4.4.1) is defined in histogram.h. It picks
+// a histogram specialized for the type of the items -- an array of
+// counters for chars, and a flat hash table for strings. This is the
+// version which always uses std::unordered_map.
 template <typename C, typename T = typename C::value_type>
-auto count_occurences(const C &collection)
+auto count_occurences_unordered(const C &collection)
     -> std::unordered_map<T, unsigned int> {
   std::unordered_map<T, unsigned int> result;
 
@@ -33,7 +46,56 @@ auto reverse_pairs(const C &items) -> std::vector<std::pair<P2, P1>> {
   return result;
 }
 
-auto main() -> int {
+// A temporary string_histogram takes its keys with it, the pairs
+// reversed from it need their own copies of the words
+template <typename C,
+          typename = std::enable_if_t<!std::is_lvalue_reference_v<C>>,
+          typename P1 = owned_key_t<typename std::remove_cv<
+              typename C::value_type::first_type>::type>,
+          typename P2 = typename C::value_type::second_type>
+auto reverse_pairs(C &&items) -> std::vector<std::pair<P2, P1>> {
+  std::vector<std::pair<P2, P1>> result;
+  result.reserve(items.size());
+  for (const auto &[first, second] : items) {
+    result.emplace_back(second, P1(first));
+  }
+  return result;
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A text where a few words are very common and most are rare
+auto generate_words(std::size_t count, std::size_t vocabulary)
+    -> std::vector<std::string> {
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::vector<std::string> result;
+  result.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto rank =
+        static_cast<std::size_t>(std::pow(vocabulary, uniform(random)));
+    result.push_back("word" + std::to_string(rank));
+  }
+  return result;
+}
+
+// Checks that a histogram has the same counts as std::unordered_map
+template <typename Histogram, typename Map>
+auto same_counts(const Histogram &histogram, const Map &expected) -> bool {
+  if (histogram.size() != expected.size())
+    return false;
+  return std::all_of(expected.cbegin(), expected.cend(), [&](const auto &p) {
+    return histogram.count(p.first) == p.second;
+  });
+}
+
+auto main(int argc, char *argv[]) -> int {
   std::string sentence = "Hello world";
   std::vector<std::string> words{std::string("The"),    std::string("Farm"),
                                  std::string("from"),   std::string("the"),
@@ -48,4 +110,138 @@ auto main() -> int {
   for (const auto &item : reverse_pairs(count_occurences(words))) {
     std::cout << item.first << " " << item.second << '\n';
   }
+
+  std::cout << "---\n";
+
+  // When we only need the most frequent words, there is no need
+  // to reverse and sort all of them
+  for (const auto &item : top_k_by_frequency(count_occurences(words), 2)) {
+    std::cout << item.first << " " << item.second << '\n';
+  }
+
+  // some tests
+  const auto word_counts = count_occurences(words);
+  if (!same_counts(count_occurences(sentence),
+                   count_occurences_unordered(sentence)))
+    throw;
+  if (!same_counts(word_counts, count_occurences_unordered(words)))
+    throw;
+  if (word_counts.count("Farm") != 2 || word_counts.count("farm") != 0)
+    throw;
+  auto reversed = reverse_pairs(count_occurences(words));
+  auto expected_reversed = reverse_pairs(count_occurences_unordered(words));
+  std::sort(reversed.begin(), reversed.end());
+  std::sort(expected_reversed.begin(), expected_reversed.end());
+  if (reversed != expected_reversed)
+    throw;
+  if (top_k_by_frequency(word_counts, 3) !=
+      std::vector<std::pair<unsigned int, std::string_view>>{
+          {2, "Farm"}, {1, "Animal"}, {1, "The"}})
+    throw;
+  if (top_k_by_frequency(count_occurences(words), 3) !=
+      std::vector<std::pair<unsigned int, std::string>>{
+          {2, "Farm"}, {1, "Animal"}, {1, "The"}})
+    throw;
+  if (!top_k_by_frequency(word_counts, 0).empty() ||
+      top_k_by_frequency(word_counts, 10).size() != word_counts.size())
+    throw;
+  if (top_k_by_frequency(count_occurences_unordered(words), 3) !=
+      std::vector<std::pair<unsigned int, std::string>>{
+          {2, "Farm"}, {1, "Animal"}, {1, "The"}})
+    throw;
+  // Counts which would overflow are rejected, and do not
+  // lose the word they belong to
+  string_histogram huge_counts;
+  huge_counts.add("Farm", UINT_MAX);
+  huge_counts.add("Animal");
+  bool overflowed = false;
+  try {
+    huge_counts.add("Farm");
+  } catch (const std::overflow_error &) {
+    overflowed = true;
+  }
+  if (!overflowed || huge_counts.try_add("Farm", 2) ||
+      huge_counts.count("Farm") != UINT_MAX ||
+      huge_counts.count("Animal") != 1 || huge_counts.size() != 2)
+    throw;
+  if (!same_counts(count_occurences(std::vector<int>{1, 2, 2, 3}),
+                   count_occurences_unordered(std::vector<int>{1, 2, 2, 3})))
+    throw;
+
+  // Benchmark
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const auto text = generate_words(size, 100000);
+  std::string characters;
+  for (const auto &word : text) {
+    characters += word;
+    characters += ' ';
+  }
+  const auto threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::unordered_map<std::string, unsigned int> unordered_words;
+  const auto unordered_words_time =
+      measure([&] { unordered_words = count_occurences_unordered(text); });
+
+  string_histogram flat_words;
+  const auto flat_words_time =
+      measure([&] { flat_words = count_occurences(text); });
+
+  string_histogram parallel_words;
+  const auto parallel_words_time =
+      measure([&] { parallel_words = count_occurences(text, threads); });
+
+  std::unordered_map<char, unsigned int> unordered_chars;
+  const auto unordered_chars_time = measure(
+      [&] { unordered_chars = count_occurences_unordered(characters); });
+
+  dense_histogram<char> dense_chars;
+  const auto dense_chars_time =
+      measure([&] { dense_chars = count_occurences(characters); });
+
+  if (!same_counts(flat_words, unordered_words) ||
+      !same_counts(parallel_words, unordered_words) ||
+      !same_counts(dense_chars, unordered_chars))
+    throw;
+  for (unsigned int test_threads : {2u, 3u, 8u}) {
+    if (!same_counts(count_occurences(text, test_threads), unordered_words) ||
+        !same_counts(count_occurences(characters, test_threads),
+                     unordered_chars))
+      throw;
+  }
+
+  // The most frequent words, by sorting all of them and with a heap
+  const std::size_t k = 10;
+  std::vector<std::pair<unsigned int, std::string_view>> sorted_top;
+  const auto sorted_top_time = measure([&] {
+    sorted_top = reverse_pairs(flat_words);
+    std::sort(sorted_top.begin(), sorted_top.end(),
+              [](const auto &left, const auto &right) {
+                return left.first != right.first ? left.first > right.first
+                                                 : left.second < right.second;
+              });
+    sorted_top.resize(std::min(k, sorted_top.size()));
+  });
+
+  std::vector<std::pair<unsigned int, std::string_view>> heap_top;
+  const auto heap_top_time =
+      measure([&] { heap_top = top_k_by_frequency(flat_words, k); });
+
+  if (heap_top != sorted_top)
+    throw;
+
+  std::cout << "counting " << size << " words, " << unordered_words.size()
+            << " distinct\n"
+            << "  std::unordered_map:          " << unordered_words_time
+            << "ms\n"
+            << "  string_histogram:            " << flat_words_time << "ms\n"
+            << "  on " << threads << " thread(s):              "
+            << parallel_words_time << "ms\n"
+            << "counting " << characters.size() << " characters\n"
+            << "  std::unordered_map:          " << unordered_chars_time
+            << "ms\n"
+            << "  dense_histogram:             " << dense_chars_time
+            << "ms\n"
+            << "the " << k << " most frequent words\n"
+            << "  reverse_pairs and sort:      " << sorted_top_time << "ms\n"
+            << "  top_k_by_frequency:          " << heap_top_time << "ms\n";
 }
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "histogram.h"
+#include "word_count_index.h"
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// A text where a few words are very common and most are rare
+auto generate_words(std::size_t count, std::size_t vocabulary, unsigned seed)
+    -> std::vector<std::string> {
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  std::vector<std::string> result;
+  result.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto rank =
+        static_cast<std::size_t>(std::pow(vocabulary, uniform(random)));
+    result.push_back("word" + std::to_string(rank));
+  }
+  return result;
+}
+
+// The index needs to give the same answers as counting everything
+// in memory
+auto same_counts(const word_count_index &index,
+                 const string_histogram &expected) -> bool {
+  for (const auto &[word, count] : expected) {
+    if (index.count(word) != count)
+      return false;
+  }
+  if (index.count("not a word") != 0)
+    return false;
+
+  const auto top = index.top_k(20);
+  const auto expected_top = top_k_by_frequency(expected, 20);
+  auto same = [](const auto &left, const auto &right) {
+    return left.first == right.first && left.second == right.second;
+  };
+  return std::equal(top.cbegin(), top.cend(), expected_top.cbegin(),
+                    expected_top.cend(), same);
+}
+
+auto main(int argc, char *argv[]) -> int {
+  // The pid keeps concurrent runs from removing each other's runs
+  const auto directory =
+      std::filesystem::temp_directory_path() /
+      ("word-count-index-example-" + std::to_string(::getpid()));
+  std::filesystem::remove_all(directory);
+
+  // some tests, with a small memory limit to get a lot of runs
+  {
+    string_histogram expected;
+    {
+      word_count_index index(directory, {1000, 4});
+      for (unsigned document = 0; document < 20; ++document) {
+        const auto words = generate_words(10000, 20000, document);
+        index.add_words(words);
+        for (const auto &word : words) {
+          expected.add(word);
+        }
+      }
+
+      // Words in memory and on disk are counted together
+      if (!same_counts(index, expected))
+        throw;
+
+      index.flush();
+      index.wait_for_merges();
+      if (index.run_count() >= 4 * 3)
+        throw;
+      if (!same_counts(index, expected))
+        throw;
+
+      index.add("word1", 5);
+      expected.add("word1", 5);
+    }
+
+    // Opening the index again, and adding new documents
+    // without counting the old ones again
+    {
+      word_count_index index(directory, {1000, 4});
+      if (!same_counts(index, expected))
+        throw;
+
+      const auto words = generate_words(10000, 20000, 100);
+      index.add_words(words);
+      for (const auto &word : words) {
+        expected.add(word);
+      }
+      if (!same_counts(index, expected))
+        throw;
+    }
+
+    // What an interrupted merge leaves behind: an unfinished run, or
+    // a finished one along with the runs it contains
+    {
+      // The oldest run is a merged one, it starts with the first flush
+      const std::vector<std::filesystem::path> runs(
+          std::filesystem::directory_iterator(directory), {});
+      const auto merged = *std::min_element(runs.cbegin(), runs.cend());
+      const auto contained = directory / "0000000000-0000000000.run";
+      const auto unfinished = directory / "9999999999-9999999999.run.tmp";
+      if (merged.filename() == contained.filename())
+        throw;
+      std::filesystem::copy_file(merged, contained);
+      std::filesystem::copy_file(merged, unfinished);
+
+      word_count_index index(directory, {1000, 4});
+      if (std::filesystem::exists(contained) ||
+          std::filesystem::exists(unfinished))
+        throw;
+      if (!same_counts(index, expected))
+        throw;
+
+      // Counts which do not fit into the memory are flushed
+      // before they overflow
+      index.add("many", UINT_MAX);
+      index.add("many", UINT_MAX);
+      if (index.count("many") != 2 * std::uint64_t(UINT_MAX) ||
+          index.top_k(1).front() !=
+              std::pair<std::uint64_t, std::string>{2 * std::uint64_t(UINT_MAX),
+                                                    "many"})
+        throw;
+    }
+
+    // Corrupt runs are rejected when they are opened, instead of
+    // reading outside of the mapping
+    {
+      const std::vector<std::filesystem::path> runs(
+          std::filesystem::directory_iterator(directory), {});
+      const auto corrupt = directory / "corrupt";
+      auto rejected = [&](std::size_t offset_from_end, std::uint64_t value) {
+        std::filesystem::copy_file(
+            runs.front(), corrupt,
+            std::filesystem::copy_options::overwrite_existing);
+        std::fstream file(corrupt,
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-static_cast<std::streamoff>(offset_from_end),
+                   std::ios::end);
+        file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        file.close();
+        try {
+          word_run run(corrupt.string());
+        } catch (const std::runtime_error &) {
+          return true;
+        }
+        return false;
+      };
+      auto footer_field = [](std::size_t offset) {
+        return sizeof(word_run_footer) - offset;
+      };
+
+      // The index count, so large that the size of the index overflows
+      if (!rejected(footer_field(offsetof(word_run_footer, index_count)),
+                    std::uint64_t(1) << 61))
+        throw;
+      // The last index entry, pointing past the records
+      if (!rejected(sizeof(word_run_footer) + sizeof(std::uint64_t),
+                    UINT64_MAX - 2))
+        throw;
+      // The record count, disagreeing with the index
+      if (!rejected(footer_field(offsetof(word_run_footer, record_count)),
+                    0))
+        throw;
+      std::filesystem::remove(corrupt);
+    }
+  }
+  std::filesystem::remove_all(directory);
+
+  // Benchmark
+  const std::size_t size = argc > 1 ? std::atoi(argv[1]) : 5000000;
+  const std::size_t document_size = 100000;
+
+  std::vector<std::vector<std::string>> documents;
+  for (std::size_t i = 0; i * document_size < size; ++i) {
+    documents.push_back(generate_words(document_size, 1000000, i));
+  }
+
+  string_histogram in_memory;
+  const auto in_memory_time = measure([&] {
+    for (const auto &document : documents) {
+      for (const auto &word : document) {
+        in_memory.add(word);
+      }
+    }
+  });
+
+  word_count_index index(directory, {1 << 16, 4});
+  const auto index_time = measure([&] {
+    for (const auto &document : documents) {
+      index.add_words(document);
+    }
+    index.flush();
+  });
+  const auto merge_time = measure([&] { index.wait_for_merges(); });
+
+  std::vector<std::pair<unsigned int, std::string_view>> in_memory_top;
+  const auto in_memory_top_time =
+      measure([&] { in_memory_top = top_k_by_frequency(in_memory, 10); });
+
+  std::vector<std::pair<std::uint64_t, std::string>> index_top;
+  const auto index_top_time = measure([&] { index_top = index.top_k(10); });
+
+  for (std::size_t i = 0; i < index_top.size(); ++i) {
+    if (index_top[i].first != in_memory_top[i].first ||
+        index_top[i].second != in_memory_top[i].second)
+      throw;
+  }
+
+  std::cout << "counting " << documents.size() * document_size << " words, "
+            << in_memory.size() << " distinct\n"
+            << "  in memory:                   " << in_memory_time << "ms\n"
+            << "  in the index:                " << index_time << "ms\n"
+            << "  waiting for the merges:      " << merge_time << "ms, "
+            << index.run_count() << " runs left\n"
+            << "the 10 most frequent words\n"
+            << "  in memory:                   " << in_memory_top_time
+            << "ms\n"
+            << "  in the index:                " << index_top_time << "ms\n";
+
+  for (const auto &[count, word] : index_top) {
+    std::cout << count << " " << word << '\n';
+  }
+
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "person.h"
+#include "person_table.h"
+#include "predicates.h"
+#include "random_people.h"
+
+// The generic function object from 3.1
+class older_than {
+public:
+  older_than(int limit) : m_limit(limit) {}
+
+  template <typename T> bool operator()(T &&object) const {
+    return std::forward<T>(object).age() > m_limit;
+  }
+
+private:
+  int m_limit;
+};
+
+auto is_female(const person_t &person) -> bool {
+  return person.gender() == person_t::female;
+}
+
+auto is_not_female(const person_t &person) -> bool {
+  return !is_female(person);
+}
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Checks that the batch evaluation over a table gives the same
+// results as calling the predicate for every person
+template <typename P>
+void check(const std::vector<person_t> &people, const person_table &table,
+           const P &predicate) {
+  std::vector<std::uint32_t> expected;
+  for (std::uint32_t i = 0; i < people.size(); ++i) {
+    if (predicate(people[i])) {
+      expected.push_back(i);
+    }
+  }
+  if (predicates::select(table, predicate) != expected)
+    throw;
+  if (predicates::count_if(table, predicate) != expected.size())
+    throw;
+}
+
+auto main(int argc, char *argv[]) -> int {
+  using predicates::age;
+  using predicates::gender;
+  using predicates::lift;
+  using predicates::project;
+
+  const std::vector<person_t> people{
+      {"David", person_t::male, 50},    {"Jane", person_t::female, 30},
+      {"Martha", person_t::female, 45}, {"Peter", person_t::male, 20},
+      {"Rose", person_t::female, 60},   {"Tom", person_t::male, 42}};
+
+  // Instead of a lambda which calls is_female and older_than(42)
+  const auto older_females = gender == person_t::female && age > 42;
+
+  std::for_each(cbegin(people), cend(people), [&](const person_t &person) {
+    if (older_females(person)) {
+      person.print(std::cout, person_t::name_only);
+    }
+  });
+
+  // Existing predicates and projections can be mixed in
+  const auto young_or_male = lift(is_not_female) || age <= 30;
+  const auto long_name = project([](const auto &person) {
+                           return person.name().size();
+                         }) > 4u;
+
+  // some tests
+  if (std::count_if(cbegin(people), cend(people), older_females) != 2)
+    throw;
+  if (std::count_if(cbegin(people), cend(people), young_or_male) != 4)
+    throw;
+  if (std::count_if(cbegin(people), cend(people), !young_or_male) != 2)
+    throw;
+  if (std::count_if(cbegin(people), cend(people), long_name) != 3)
+    throw;
+  if (std::count_if(cbegin(people), cend(people), 42 < age) !=
+      std::count_if(cbegin(people), cend(people), older_than(42)))
+    throw;
+
+  // Batch evaluation over a table gives the same results
+  const auto population =
+      random_people(argc > 1 ? std::atoi(argv[1]) : 1000000);
+  const person_table table(population);
+
+  check(population, table, older_females);
+  check(population, table, !older_females);
+  check(population, table, age >= 42 || gender != person_t::male);
+  check(population, table,
+        age < 18 || (age == 65 && !(gender == person_t::other)));
+  check(population, table, lift(older_than(42)) && age <= 42);
+  check(population, table, long_name && age != 30);
+
+  // Benchmark
+  std::size_t lambda_count = 0;
+  const auto lambda_time = measure([&] {
+    lambda_count = std::count_if(
+        cbegin(population), cend(population), [](const person_t &person) {
+          return is_female(person) && older_than(42)(person);
+        });
+  });
+
+  std::size_t fused_count = 0;
+  const auto fused_time = measure([&] {
+    fused_count =
+        std::count_if(cbegin(population), cend(population), older_females);
+  });
+
+  std::size_t table_count = 0;
+  const auto table_time = measure(
+      [&] { table_count = predicates::count_if(table, older_females); });
+
+  if (lambda_count != fused_count || lambda_count != table_count)
+    throw;
+
+  std::cout << "lambda over std::vector<person_t>:      " << lambda_time
+            << "ms\n"
+            << "combinators over std::vector<person_t>: " << fused_time
+            << "ms\n"
+            << "combinators over person_table:          " << table_time
+            << "ms\n";
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "person.h"
+#include "person_table.h"
+#include "predicates.h"
+#include "query.h"
+#include "random_people.h"
+
+template <typename F> auto measure(F &&f) -> double {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// The hand-written loop the queries replace: the average age
+// of the persons older than 18, for every gender
+auto average_adult_age_by_gender(const std::vector<person_t> &people)
+    -> std::vector<double> {
+  std::vector<double> sums(3);
+  std::vector<std::size_t> counts(3);
+  for (const auto &person : people) {
+    if (person.age() > 18) {
+      sums[person.gender()] += person.age();
+      ++counts[person.gender()];
+    }
+  }
+  std::vector<double> result(3);
+  for (std::size_t gender = 0; gender < 3; ++gender) {
+    result[gender] = counts[gender] ? sums[gender] / counts[gender] : 0.0;
+  }
+  return result;
+}
+
+auto main(int argc, char *argv[]) -> int {
+  using predicates::age;
+  using predicates::gender;
+
+  const std::vector<person_t> people{
+      {"David", person_t::male, 50},    {"Jane", person_t::female, 30},
+      {"Martha", person_t::female, 45}, {"Peter", person_t::male, 20},
+      {"Rose", person_t::female, 60},   {"Tom", person_t::male, 42}};
+  const person_table table(people);
+
+  const auto older = query::from(table).where(age > 25);
+
+  for (auto name : older.where(gender == person_t::female)
+                       .project([](const person_view &person) {
+                         return person.name();
+                       })) {
+    std::cout << name << '\n';
+  }
+
+  const auto by_gender = older.group_by(query::gender_groups()).aggregate();
+  std::cout << "average age of males older than 25: "
+            << by_gender[person_t::male].average_age() << '\n';
+
+  // some tests
+  if (older.count() != 5)
+    throw;
+  if (older.where(gender == person_t::male).rows() !=
+      std::vector<std::uint32_t>{0, 5})
+    throw;
+  if (by_gender[person_t::female].count != 3 ||
+      by_gender[person_t::female].average_age() != 45 ||
+      by_gender[person_t::male].min_age != 42 ||
+      by_gender[person_t::male].max_age != 50 ||
+      by_gender[person_t::other].count != 0)
+    throw;
+  if (query::from(table).group_by(query::age_groups{20}).count_by_group() !=
+      std::vector<std::size_t>{0, 2, 3, 1, 0, 0, 0, 0})
+    throw;
+  if (query::from(table).average_age() != 247.0 / 6)
+    throw;
+
+  // Benchmark
+  const auto population =
+      random_people(argc > 1 ? std::atoi(argv[1]) : 1000000);
+  const person_table population_table(population);
+  const auto threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<double> loop_result;
+  const auto loop_time = measure(
+      [&] { loop_result = average_adult_age_by_gender(population); });
+
+  const auto adults_by_gender = query::from(population_table)
+                                    .where(age > 18)
+                                    .group_by(query::gender_groups());
+
+  std::vector<query::group_stats> single_result;
+  const auto single_time = measure(
+      [&] { single_result = adults_by_gender.threads(1).aggregate(); });
+
+  std::vector<query::group_stats> parallel_result;
+  const auto parallel_time = measure([&] {
+    parallel_result = adults_by_gender.threads(threads).aggregate();
+  });
+
+  for (std::size_t gender = 0; gender < 3; ++gender) {
+    if (std::abs(single_result[gender].average_age() - loop_result[gender]) >
+            1e-9 ||
+        single_result[gender].age_sum != parallel_result[gender].age_sum ||
+        single_result[gender].count != parallel_result[gender].count)
+      throw;
+  }
+
+  // The results do not depend on the number of threads
+  const auto selective = query::from(population_table)
+                             .where(age >= 90 && gender != person_t::other);
+  for (unsigned int test_threads : {2u, 3u, 7u}) {
+    if (selective.threads(test_threads).rows() !=
+            selective.threads(1).rows() ||
+        selective.threads(test_threads).count() != selective.threads(1).count())
+      throw;
+  }
+
+  std::cout << "average age of adults by gender, " << population.size()
+            << " persons\n"
+            << "loop over std::vector<person_t>:  " << loop_time << "ms\n"
+            << "query on 1 thread:                " << single_time << "ms\n"
+            << "query on " << threads << " thread(s):             "
+            << parallel_time << "ms\n";
+}
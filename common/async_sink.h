@@ -0,0 +1,274 @@
+#ifndef ASYNC_SINK_H
+#define ASYNC_SINK_H
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "person_writer.h"
+
+// A file that is written on a background thread.
+//
+// Writing to a file blocks the writing thread until the kernel has
+// copied the data, and when the disk can not keep up, for much longer.
+// async_sink only copies the record into a ring buffer, the records
+// are taken from it by a background thread which collects them into
+// a buffered_writer and writes them in large batches.
+//
+// Any number of threads can write to the same sink. The ring buffer
+// does not use locks: a writer reserves a slot by incrementing the
+// position of the tail with a compare-and-swap, copies the record
+// into the slot (reusing the memory of the records that were in it
+// before), and marks the slot as full by storing its sequence number.
+// The background thread is the only consumer, it takes the slots in
+// order and marks them as empty for the next round.
+//
+// When the ring buffer is full, a writer either waits for the
+// background thread to make room, or drops the record and returns
+// false, depending on the overflow_policy. The records are written
+// in the order in which the writers reserved their slots, and the
+// records of a single thread are written in the order it wrote them.
+//
+// flush() waits until everything written before it is in the file,
+// and the destructor writes everything that is left in the ring
+// buffer before it closes the file.
+
+enum class overflow_policy {
+  block, // waits until there is room for the record
+  drop   // discards the record
+};
+
+struct async_sink_options {
+  // The number of records the ring buffer can hold, a power of two
+  std::size_t capacity = 1 << 14;
+
+  overflow_policy when_full = overflow_policy::block;
+};
+
+class async_sink {
+public:
+  explicit async_sink(const std::string &path, async_sink_options options = {})
+      : m_policy(options.when_full),
+        m_slots(round_up_to_power_of_two(options.capacity)),
+        m_mask(m_slots.size() - 1) {
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "can not open " + path);
+    }
+
+    m_writer = std::thread([this] { write_records(); });
+  }
+
+  async_sink(const async_sink &) = delete;
+  async_sink &operator=(const async_sink &) = delete;
+
+  // Writes everything that was written to the sink, and closes the file
+  ~async_sink() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+    ::close(m_fd);
+  }
+
+  // Queues the record to be written. The record is written as it is,
+  // if it needs to end with a newline, it should contain one. Returns
+  // false when the record was dropped because the buffer was full.
+  bool write(std::string_view record) {
+    auto position = m_tail.load(std::memory_order_relaxed);
+    slot_t *slot;
+    for (;;) {
+      slot = &m_slots[position & m_mask];
+      const auto sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+      if (difference == 0) {
+        // The slot is empty, it is ours if nobody took it in the meantime
+        if (m_tail.compare_exchange_weak(position, position + 1,
+                                         std::memory_order_relaxed)) {
+          break;
+        }
+
+      } else if (difference < 0) {
+        // The slot still has a record from the previous round,
+        // the buffer is full
+        if (m_policy == overflow_policy::drop) {
+          m_dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        std::this_thread::yield();
+        position = m_tail.load(std::memory_order_relaxed);
+
+      } else {
+        // Another writer took the slot, trying the next one
+        position = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->record.assign(record.data(), record.size());
+    slot->sequence.store(position + 1);
+
+    if (m_consumer_waiting.load()) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_wake.notify_one();
+    }
+    return true;
+  }
+
+  // Waits until all the records written to the sink before the call
+  // are written to the file. Rethrows the error if writing has failed.
+  void flush() {
+    const auto target = m_tail.load();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_flushed.wait(lock, [&] { return m_written >= target || m_error; });
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+
+  // The number of records that were dropped because the buffer was full
+  std::size_t dropped() const {
+    return m_dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct alignas(64) slot_t {
+    // position + 1 when the slot holds the record of the position,
+    // position + capacity when it is empty for the writer of that
+    // position, which is in the next round of the buffer
+    std::atomic<std::size_t> sequence;
+    std::string record;
+  };
+
+  static std::size_t round_up_to_power_of_two(std::size_t value) {
+    std::size_t result = 2;
+    while (result < value) {
+      result *= 2;
+    }
+    return result;
+  }
+
+  static constexpr int spins_before_sleeping = 64;
+
+  bool has_record() const {
+    return m_slots[m_head & m_mask].sequence.load() == m_head + 1;
+  }
+
+  // The background thread
+  void write_records() {
+    buffered_writer out(m_fd, 1 << 16);
+
+    for (;;) {
+      bool failed;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        failed = bool(m_error);
+      }
+
+      // Taking all the records that are ready
+      const auto first = m_head;
+      while (has_record()) {
+        auto &slot = m_slots[m_head & m_mask];
+        if (!failed) {
+          try {
+            out.append(slot.record);
+          } catch (...) {
+            set_error(std::current_exception());
+            failed = true;
+          }
+        }
+        slot.sequence.store(m_head + m_slots.size(),
+                            std::memory_order_release);
+        ++m_head;
+      }
+
+      if (m_head != first) {
+        if (!failed) {
+          try {
+            out.flush();
+          } catch (...) {
+            set_error(std::current_exception());
+          }
+        }
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_written = m_head;
+        }
+        m_flushed.notify_all();
+        continue;
+      }
+
+      // Nothing is ready. Giving the writers some time before going
+      // to sleep, so that they can write more than a record or two
+      // before they need to wake us up, and we can write them at once.
+      for (int i = 0; i < spins_before_sleeping && !has_record(); ++i) {
+        std::this_thread::yield();
+      }
+      if (has_record()) {
+        continue;
+      }
+
+      // Waiting for the writers. A writer that stores its record after
+      // we have checked for it sees that we are waiting, and has to
+      // wait for the mutex to wake us.
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_consumer_waiting.store(true);
+      if (!has_record()) {
+        if (m_stopping) {
+          m_consumer_waiting.store(false);
+          return;
+        }
+        m_wake.wait(lock);
+      }
+      m_consumer_waiting.store(false);
+    }
+  }
+
+  void set_error(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_error) {
+      m_error = error;
+    }
+  }
+
+  const overflow_policy m_policy;
+  std::vector<slot_t> m_slots;
+  const std::size_t m_mask;
+  int m_fd = -1;
+
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+  std::atomic<std::size_t> m_dropped{0};
+
+  // Only used by the background thread
+  alignas(64) std::size_t m_head = 0;
+
+  std::atomic<bool> m_consumer_waiting{false};
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_flushed;
+  std::size_t m_written = 0;
+  bool m_stopping = false;
+  std::exception_ptr m_error;
+
+  std::thread m_writer;
+};
+
+#endif // ASYNC_SINK_H
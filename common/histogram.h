@@ -0,0 +1,501 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Histograms -- collections that count how many times each
+// distinct value occurs, specialized by the type of the values.
+//
+// Counting with std::unordered_map<T, unsigned int> allocates a node
+// for every distinct value, and hashes every value it sees. Most
+// values we count do not need that:
+//  - dense_histogram is for integral types of one or two bytes, like
+//    chars. Every possible value has its own counter in an array, the
+//    value is the index of its counter, and nothing is hashed.
+//  - string_histogram is for strings. It is an open addressing hash
+//    table with linear probing, with the slots in a single array, and
+//    the characters of the keys copied into one arena. Adding a word
+//    that was already counted does not allocate anything. The keys
+//    it gives out are views of the arena, they are valid only while
+//    the histogram is alive -- owned_key_t<T> is the type to copy
+//    them into when they need to outlive it.
+//  - node_histogram wraps std::unordered_map, for everything else.
+//
+// histogram_for<T> picks the right one for a value type. All of them
+// can be iterated as (value, count) pairs, and histograms of the same
+// type can be merged, which is what count_occurences uses to count
+// in parallel -- every thread counts its part of the collection into
+// its own histogram, and the histograms are merged at the end.
+
+// Iterates over the non-empty slots of a histogram, the histogram
+// tells what the slots are and how to turn one into a pair
+template <typename Histogram>
+class histogram_iterator {
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename Histogram::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = value_type;
+
+  histogram_iterator(const Histogram *histogram, std::size_t slot)
+      : m_histogram(histogram), m_slot(slot) {
+    skip_empty();
+  }
+
+  value_type operator*() const { return m_histogram->slot_value(m_slot); }
+
+  histogram_iterator &operator++() {
+    ++m_slot;
+    skip_empty();
+    return *this;
+  }
+
+  histogram_iterator operator++(int) {
+    auto result = *this;
+    ++*this;
+    return result;
+  }
+
+  friend bool operator==(const histogram_iterator &left,
+                         const histogram_iterator &right) {
+    return left.m_slot == right.m_slot;
+  }
+
+  friend bool operator!=(const histogram_iterator &left,
+                         const histogram_iterator &right) {
+    return left.m_slot != right.m_slot;
+  }
+
+private:
+  void skip_empty() {
+    while (m_slot < m_histogram->slot_count() &&
+           !m_histogram->slot_used(m_slot)) {
+      ++m_slot;
+    }
+  }
+
+  const Histogram *m_histogram;
+  std::size_t m_slot;
+};
+
+template <typename T> class dense_histogram {
+  static_assert(std::is_integral_v<T> && sizeof(T) <= 2,
+                "dense_histogram needs a small integral type");
+
+public:
+  using key_type = T;
+  using value_type = std::pair<T, unsigned int>;
+  using const_iterator = histogram_iterator<dense_histogram>;
+
+  void add(T value, unsigned int count = 1) {
+    if (count == 0) {
+      return;
+    }
+    auto &counter = m_counts[index_of(value)];
+    m_size += counter == 0;
+    counter += count;
+  }
+
+  unsigned int count(T value) const { return m_counts[index_of(value)]; }
+
+  // The number of distinct values
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  void merge(const dense_histogram &other) {
+    for (std::size_t i = 0; i < m_counts.size(); ++i) {
+      m_size += m_counts[i] == 0 && other.m_counts[i] != 0;
+      m_counts[i] += other.m_counts[i];
+    }
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, slot_count()); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+private:
+  friend class histogram_iterator<dense_histogram>;
+
+  static constexpr std::size_t value_count =
+      std::size_t(1) << (8 * sizeof(T));
+
+  static std::size_t index_of(T value) {
+    return static_cast<std::size_t>(
+        static_cast<std::make_unsigned_t<T>>(value));
+  }
+
+  std::size_t slot_count() const { return value_count; }
+  bool slot_used(std::size_t slot) const { return m_counts[slot] != 0; }
+  value_type slot_value(std::size_t slot) const {
+    return {static_cast<T>(slot), m_counts[slot]};
+  }
+
+  std::vector<unsigned int> m_counts = std::vector<unsigned int>(value_count);
+  std::size_t m_size = 0;
+};
+
+class string_histogram {
+public:
+  using key_type = std::string_view;
+  using value_type = std::pair<std::string_view, unsigned int>;
+  using const_iterator = histogram_iterator<string_histogram>;
+
+  string_histogram() : m_slots(initial_capacity) {}
+
+  // Throws std::overflow_error if the count of the value would not
+  // fit into an unsigned int, and std::length_error if the values
+  // would take more than 4GB
+  void add(std::string_view value, unsigned int count = 1) {
+    if (!try_add(value, count)) {
+      throw std::overflow_error("the count does not fit the histogram");
+    }
+  }
+
+  // The same as add, but returns false instead of throwing when
+  // the count would overflow. The histogram is not changed then.
+  bool try_add(std::string_view value, unsigned int count = 1) {
+    if (count == 0) {
+      return true;
+    }
+    return add(value, hash_of(value), count);
+  }
+
+  unsigned int count(std::string_view value) const {
+    const auto hash = hash_of(value);
+    for (auto slot = hash & mask();; slot = (slot + 1) & mask()) {
+      const auto &current = m_slots[slot];
+      if (!current.used) {
+        return 0;
+      }
+      if (current.hash == hash && key(current) == value) {
+        return current.count;
+      }
+    }
+  }
+
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  // The characters of all the distinct values, which can not
+  // be more than max_arena_size
+  std::size_t arena_size() const { return m_arena.size(); }
+  static constexpr std::size_t max_arena_size = UINT32_MAX;
+
+  void merge(const string_histogram &other) {
+    for (const auto &slot : other.m_slots) {
+      if (slot.used && !add(other.key(slot), slot.hash, slot.count)) {
+        throw std::overflow_error("the count does not fit the histogram");
+      }
+    }
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, slot_count()); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+private:
+  friend class histogram_iterator<string_histogram>;
+
+  static constexpr std::size_t initial_capacity = 1024;
+
+  // The key is stored as an offset into the arena, and not as a view,
+  // so that the arena can grow (up to 4GB)
+  struct slot_t {
+    std::size_t hash = 0;
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+    unsigned int count = 0;
+    bool used = false;
+  };
+
+  static std::size_t hash_of(std::string_view value) {
+    return std::hash<std::string_view>{}(value);
+  }
+
+  std::size_t mask() const { return m_slots.size() - 1; }
+
+  std::string_view key(const slot_t &slot) const {
+    return std::string_view(m_arena).substr(slot.offset, slot.length);
+  }
+
+  // Returns false if the count would overflow
+  bool add(std::string_view value, std::size_t hash, unsigned int count) {
+    for (auto slot = hash & mask();; slot = (slot + 1) & mask()) {
+      auto &current = m_slots[slot];
+      if (!current.used) {
+        if (value.size() > max_arena_size - m_arena.size()) {
+          throw std::length_error("the string histogram is full");
+        }
+        current.used = true;
+        current.hash = hash;
+        current.offset = static_cast<std::uint32_t>(m_arena.size());
+        current.length = static_cast<std::uint32_t>(value.size());
+        current.count = count;
+        m_arena.append(value);
+        // Keeping the table at most half full, so that
+        // the probe sequences stay short
+        if (++m_size * 2 > m_slots.size()) {
+          grow();
+        }
+        return true;
+      }
+      if (current.hash == hash && key(current) == value) {
+        if (current.count > UINT_MAX - count) {
+          return false;
+        }
+        current.count += count;
+        return true;
+      }
+    }
+  }
+
+  void grow() {
+    std::vector<slot_t> slots(m_slots.size() * 2);
+    const auto new_mask = slots.size() - 1;
+    for (const auto &slot : m_slots) {
+      if (slot.used) {
+        auto index = slot.hash & new_mask;
+        while (slots[index].used) {
+          index = (index + 1) & new_mask;
+        }
+        slots[index] = slot;
+      }
+    }
+    m_slots = std::move(slots);
+  }
+
+  std::size_t slot_count() const { return m_slots.size(); }
+  bool slot_used(std::size_t slot) const { return m_slots[slot].used; }
+  value_type slot_value(std::size_t slot) const {
+    return {key(m_slots[slot]), m_slots[slot].count};
+  }
+
+  std::vector<slot_t> m_slots;
+  std::string m_arena;
+  std::size_t m_size = 0;
+};
+
+template <typename T> class node_histogram {
+public:
+  using key_type = T;
+  using value_type = std::pair<const T, unsigned int>;
+  using const_iterator =
+      typename std::unordered_map<T, unsigned int>::const_iterator;
+
+  void add(const T &value, unsigned int count = 1) { m_counts[value] += count; }
+
+  unsigned int count(const T &value) const {
+    const auto it = m_counts.find(value);
+    return it == m_counts.end() ? 0 : it->second;
+  }
+
+  std::size_t size() const { return m_counts.size(); }
+  bool empty() const { return m_counts.empty(); }
+
+  void merge(const node_histogram &other) {
+    for (const auto &[value, count] : other.m_counts) {
+      m_counts[value] += count;
+    }
+  }
+
+  const_iterator begin() const { return m_counts.begin(); }
+  const_iterator end() const { return m_counts.end(); }
+  const_iterator cbegin() const { return m_counts.cbegin(); }
+  const_iterator cend() const { return m_counts.cend(); }
+
+private:
+  std::unordered_map<T, unsigned int> m_counts;
+};
+
+namespace detail {
+
+template <typename T, typename = void> struct histogram_for {
+  using type = node_histogram<T>;
+};
+
+template <typename T>
+struct histogram_for<
+    T, std::enable_if_t<std::is_integral_v<T> && sizeof(T) <= 2>> {
+  using type = dense_histogram<T>;
+};
+
+template <typename T>
+struct histogram_for<
+    T, std::enable_if_t<std::is_convertible_v<const T &, std::string_view>>> {
+  using type = string_histogram;
+};
+
+} // namespace detail
+
+template <typename T>
+using histogram_for = typename detail::histogram_for<T>::type;
+
+namespace detail {
+
+template <typename T> struct owned_key {
+  using type = T;
+};
+
+template <> struct owned_key<std::string_view> {
+  using type = std::string;
+};
+
+} // namespace detail
+
+// The type of a key which does not borrow from the histogram
+template <typename T> using owned_key_t = typename detail::owned_key<T>::type;
+
+// Counts the occurences of every item in the collection
+template <typename C, typename T = typename C::value_type>
+auto count_occurences(const C &collection) -> histogram_for<T> {
+  histogram_for<T> result;
+  for (const auto &item : collection) {
+    result.add(item);
+  }
+  return result;
+}
+
+// Counts the occurences on several threads, for random access
+// collections. Every thread counts its part of the collection,
+// and the partial histograms are then merged.
+template <typename C, typename T = typename C::value_type>
+auto count_occurences(const C &collection, unsigned int threads)
+    -> histogram_for<T> {
+  // Collections smaller than this are counted on a single thread
+  constexpr std::size_t min_part_size = 1 << 14;
+
+  const auto size = static_cast<std::size_t>(std::size(collection));
+  threads = static_cast<unsigned int>(std::max<std::size_t>(
+      1, std::min<std::size_t>(threads, size / min_part_size)));
+  const auto part_size = (size + threads - 1) / threads;
+
+  std::vector<histogram_for<T>> partial(threads);
+  auto count_part = [&](unsigned int thread) {
+    const auto first =
+        std::begin(collection) + std::min(size, thread * part_size);
+    const auto last =
+        std::begin(collection) + std::min(size, (thread + 1) * part_size);
+    for (auto it = first; it != last; ++it) {
+      partial[thread].add(*it);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int thread = 1; thread < threads; ++thread) {
+    workers.emplace_back(count_part, thread);
+  }
+  count_part(0);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  auto result = std::move(partial[0]);
+  for (unsigned int thread = 1; thread < threads; ++thread) {
+    result.merge(partial[thread]);
+  }
+  return result;
+}
+
+// Keeps the k most frequent of the values it is given, the values
+// with equal counts are ordered by the values themselves, so the
+// result does not depend on the order in which they were given.
+//
+// The values go through a heap which keeps the best k seen so far,
+// with the worst of them on top, so finding them is O(n log k) and
+// needs memory only for k values.
+template <typename T, typename Count = unsigned int> class top_k_heap {
+public:
+  using value_type = std::pair<Count, T>;
+
+  explicit top_k_heap(std::size_t k) : m_k(k) {}
+
+  // The value is copied (or moved) into the heap only when it is
+  // one of the k most frequent so far
+  template <typename U> void add(Count count, U &&value) {
+    if (m_items.size() < m_k) {
+      m_items.emplace_back(count, std::forward<U>(value));
+      std::push_heap(m_items.begin(), m_items.end(), more_frequent);
+
+    } else if (m_k != 0 && replaces_top(count, value)) {
+      std::pop_heap(m_items.begin(), m_items.end(), more_frequent);
+      m_items.back().first = count;
+      m_items.back().second = std::forward<U>(value);
+      std::push_heap(m_items.begin(), m_items.end(), more_frequent);
+    }
+  }
+
+  // The (count, value) pairs, the most frequent first
+  std::vector<value_type> take() && {
+    std::sort_heap(m_items.begin(), m_items.end(), more_frequent);
+    return std::move(m_items);
+  }
+
+private:
+  static bool more_frequent(const value_type &left, const value_type &right) {
+    return left.first != right.first ? left.first > right.first
+                                     : left.second < right.second;
+  }
+
+  // Whether the value is more frequent than the least frequent
+  // of the k, without making a value_type of it
+  template <typename U> bool replaces_top(Count count, const U &value) const {
+    const auto &top = m_items.front();
+    return count != top.first ? count > top.first : value < top.second;
+  }
+
+  std::size_t m_k;
+  std::vector<value_type> m_items;
+};
+
+// The k most frequent values of a histogram (or of anything that
+// iterates over (value, count) pairs, like std::unordered_map), as
+// (count, value) pairs, the most frequent first
+template <typename H,
+          typename T = std::remove_cv_t<
+              typename std::iterator_traits<typename H::const_iterator>::
+                  value_type::first_type>>
+auto top_k_by_frequency(const H &histogram, std::size_t k)
+    -> std::vector<std::pair<unsigned int, T>> {
+  top_k_heap<T> result(k);
+  for (const auto &[value, count] : histogram) {
+    result.add(count, value);
+  }
+  return std::move(result).take();
+}
+
+// The same for a temporary histogram. The values it gives out may be
+// views of its own memory, so the k most frequent are copied out of it
+// into owned_key_t before it is destroyed.
+template <typename H,
+          typename = std::enable_if_t<!std::is_lvalue_reference_v<H>>,
+          typename T = owned_key_t<std::remove_cv_t<
+              typename std::iterator_traits<typename H::const_iterator>::
+                  value_type::first_type>>>
+auto top_k_by_frequency(H &&histogram, std::size_t k)
+    -> std::vector<std::pair<unsigned int, T>> {
+  auto top = top_k_by_frequency(static_cast<const H &>(histogram), k);
+  std::vector<std::pair<unsigned int, T>> result;
+  result.reserve(top.size());
+  for (auto &[count, value] : top) {
+    result.emplace_back(count, T(std::move(value)));
+  }
+  return result;
+}
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,253 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// An index from names to the ids of the persons (or anything else)
+// that have them, supporting exact and prefix lookups in O(log n).
+//
+// The distinct names are kept sorted, and compressed with front coding:
+// they are split into blocks of 16, the first name in each block is
+// stored in full, and every following one only stores the length of the
+// prefix it shares with the previous name, and the rest of it. Sorted
+// names share long prefixes, so this takes much less memory than
+// a sorted array of strings. Lookups binary search the first names of
+// the blocks, and then decode a single block.
+//
+// The ids for every name are stored in one array, grouped by name.
+//
+// Building sorts all the (name, id) entries. The entries are split
+// into a chunk per thread, the chunks are sorted in parallel and then
+// merged pairwise, also in parallel.
+class name_index {
+public:
+  using entry_t = std::pair<std::string_view, std::uint32_t>;
+
+  name_index() = default;
+
+  // The entries only need to live while the index is being built
+  explicit name_index(std::vector<entry_t> entries,
+                      unsigned int threads =
+                          std::max(1u, std::thread::hardware_concurrency())) {
+    sort_entries(entries, threads);
+    encode(entries);
+  }
+
+  // Builds the index of a collection, the ids are the positions
+  // of the items in the collection
+  template <typename C, typename Projection>
+  static name_index of(const C &collection, Projection name_of,
+                       unsigned int threads =
+                           std::max(1u, std::thread::hardware_concurrency())) {
+    std::vector<entry_t> entries;
+    entries.reserve(std::size(collection));
+    std::uint32_t id = 0;
+    for (const auto &item : collection) {
+      entries.emplace_back(name_of(item), id++);
+    }
+    return name_index(std::move(entries), threads);
+  }
+
+  std::size_t distinct_names() const { return m_name_count; }
+
+  // The size of the compressed names, in bytes
+  std::size_t names_size() const { return m_data.size(); }
+
+  // Ids of the entries with exactly this name, in ascending order
+  std::vector<std::uint32_t> find(std::string_view name) const {
+    std::vector<std::uint32_t> result;
+    for_each_prefixed(name, [&](std::string_view found, auto first,
+                                auto last) {
+      if (found.size() == name.size()) {
+        result.assign(first, last);
+      }
+      return found.size() != name.size();
+    });
+    return result;
+  }
+
+  // Ids of the entries with names starting with the prefix,
+  // grouped by name, the names in lexicographical order
+  std::vector<std::uint32_t> find_prefix(std::string_view prefix) const {
+    std::vector<std::uint32_t> result;
+    for_each_prefixed(prefix, [&](std::string_view, auto first, auto last) {
+      result.insert(result.end(), first, last);
+      return true;
+    });
+    return result;
+  }
+
+  // Calls f(name, ids_begin, ids_end) for every distinct name that
+  // starts with the prefix, in order. The traversal stops when the
+  // function returns false.
+  template <typename F>
+  void for_each_prefixed(std::string_view prefix, F f) const {
+    if (m_name_count == 0) {
+      return;
+    }
+
+    // The last block whose first name is less than the prefix
+    // is the first one that can contain prefixed names
+    std::size_t low = 0;
+    std::size_t high = m_block_offsets.size();
+    while (high - low > 1) {
+      const auto mid = (low + high) / 2;
+      if (block_head(mid) < prefix) {
+        low = mid;
+      } else {
+        high = mid;
+      }
+    }
+
+    std::string name;
+    for (auto block = low; block < m_block_offsets.size(); ++block) {
+      auto position = m_block_offsets[block];
+      const auto first = block * block_size;
+      const auto last = std::min(first + block_size, m_name_count);
+      for (auto index = first; index < last; ++index) {
+        const auto shared = read_varint(position);
+        const auto length = read_varint(position);
+        name.resize(shared);
+        name.append(m_data, position, length);
+        position += length;
+
+        const std::string_view current = name;
+        if (current < prefix) {
+          continue;
+        }
+        if (current.substr(0, prefix.size()) != prefix) {
+          return;
+        }
+        if (!f(current, m_ids.cbegin() + m_id_offsets[index],
+               m_ids.cbegin() + m_id_offsets[index + 1])) {
+          return;
+        }
+      }
+    }
+  }
+
+private:
+  static constexpr std::size_t block_size = 16;
+
+  static bool entry_less(const entry_t &left, const entry_t &right) {
+    return left < right;
+  }
+
+  static void sort_entries(std::vector<entry_t> &entries,
+                           unsigned int threads) {
+    constexpr std::size_t min_chunk_size = 1 << 16;
+    const auto chunks = std::max<std::size_t>(
+        1, std::min<std::size_t>(threads, entries.size() / min_chunk_size));
+
+    std::vector<std::size_t> bounds;
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+      bounds.push_back(chunk * (entries.size() / chunks));
+    }
+    bounds.push_back(entries.size());
+
+    auto in_parallel = [](std::size_t count, auto f) {
+      std::vector<std::thread> workers;
+      for (std::size_t i = 1; i < count; ++i) {
+        workers.emplace_back(f, i);
+      }
+      f(0);
+      for (auto &worker : workers) {
+        worker.join();
+      }
+    };
+
+    in_parallel(chunks, [&](std::size_t chunk) {
+      std::sort(entries.begin() + bounds[chunk],
+                entries.begin() + bounds[chunk + 1], entry_less);
+    });
+
+    // Merging the neighbouring sorted chunks
+    while (bounds.size() > 2) {
+      std::vector<std::size_t> merged;
+      const auto pairs = (bounds.size() - 1) / 2;
+      in_parallel(pairs, [&](std::size_t pair) {
+        std::inplace_merge(entries.begin() + bounds[2 * pair],
+                           entries.begin() + bounds[2 * pair + 1],
+                           entries.begin() + bounds[2 * pair + 2],
+                           entry_less);
+      });
+      for (std::size_t i = 0; i < bounds.size(); i += 2) {
+        merged.push_back(bounds[i]);
+      }
+      if (merged.back() != entries.size()) {
+        merged.push_back(entries.size());
+      }
+      bounds = std::move(merged);
+    }
+  }
+
+  void encode(const std::vector<entry_t> &entries) {
+    m_ids.reserve(entries.size());
+    std::string_view previous;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      const auto name = entries[i].first;
+      if (i == 0 || name != previous) {
+        std::size_t shared = 0;
+        if (m_name_count % block_size == 0) {
+          m_block_offsets.push_back(m_data.size());
+        } else {
+          const auto max_shared = std::min(name.size(), previous.size());
+          while (shared < max_shared && name[shared] == previous[shared]) {
+            ++shared;
+          }
+        }
+        write_varint(shared);
+        write_varint(name.size() - shared);
+        m_data.append(name.substr(shared));
+        m_id_offsets.push_back(m_ids.size());
+        ++m_name_count;
+        previous = name;
+      }
+      m_ids.push_back(entries[i].second);
+    }
+    m_id_offsets.push_back(m_ids.size());
+    m_data.shrink_to_fit();
+  }
+
+  // The first name of a block is stored in full
+  std::string_view block_head(std::size_t block) const {
+    auto position = m_block_offsets[block];
+    read_varint(position);
+    const auto length = read_varint(position);
+    return std::string_view(m_data).substr(position, length);
+  }
+
+  void write_varint(std::size_t value) {
+    while (value >= 0x80) {
+      m_data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    m_data.push_back(static_cast<char>(value));
+  }
+
+  std::size_t read_varint(std::size_t &position) const {
+    std::size_t result = 0;
+    for (int shift = 0;; shift += 7) {
+      const auto byte = static_cast<unsigned char>(m_data[position++]);
+      result |= std::size_t(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        return result;
+      }
+    }
+  }
+
+  std::string m_data;
+  std::vector<std::size_t> m_block_offsets;
+  std::size_t m_name_count = 0;
+  std::vector<std::uint32_t> m_ids;
+  std::vector<std::size_t> m_id_offsets;
+};
+
+#endif // NAME_INDEX_H
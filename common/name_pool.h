@@ -0,0 +1,156 @@
+#ifndef NAME_POOL_H
+#define NAME_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A pool of interned strings, shared by any number of threads.
+//
+// Every distinct string is stored only once, and is identified by
+// a 32-bit id. Two strings interned in the same pool are equal
+// if and only if their ids are equal, so comparing interned names
+// is an integer comparison, and a collection of persons needs
+// only 4 bytes per name instead of a std::string.
+//
+// The pool is split into shards, each with its own lock, and the
+// shard is selected by the hash of the string. Threads interning
+// different strings rarely wait for each other, and looking up
+// a string that is already in the pool only takes a shared lock.
+//
+// The characters are copied into large chunks that are never
+// moved or freed while the pool lives, so the views returned
+// by the pool remain valid.
+class name_pool {
+public:
+  using id_t = std::uint32_t;
+
+  name_pool() = default;
+  name_pool(const name_pool &) = delete;
+  name_pool &operator=(const name_pool &) = delete;
+
+  // Returns the id of the string, adding it to the pool
+  // if it is not already there
+  id_t intern(std::string_view value) {
+    const auto hash = std::hash<std::string_view>{}(value);
+    const auto shard_index = hash % shard_count;
+    auto &shard = m_shards[shard_index];
+
+    {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      const auto it = shard.ids.find(value);
+      if (it != shard.ids.end()) {
+        return it->second;
+      }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    // Another thread might have added it while we were not holding the lock
+    const auto it = shard.ids.find(value);
+    if (it != shard.ids.end()) {
+      return it->second;
+    }
+
+    const auto local_index = shard.strings.size();
+    if (local_index >= max_shard_size) {
+      throw std::length_error("the name pool is full");
+    }
+
+    const auto stored = shard.store(value);
+    const auto id = static_cast<id_t>(local_index * shard_count + shard_index);
+    shard.strings.push_back(stored);
+    shard.ids.emplace(stored, id);
+    return id;
+  }
+
+  // Returns the id of the string if it is in the pool,
+  // without adding it
+  std::optional<id_t> find(std::string_view value) const {
+    const auto &shard =
+        m_shards[std::hash<std::string_view>{}(value) % shard_count];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto it = shard.ids.find(value);
+    if (it == shard.ids.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  // The string with the given id. The view is valid
+  // as long as the pool is.
+  std::string_view operator[](id_t id) const {
+    const auto &shard = m_shards[id % shard_count];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.strings[id / shard_count];
+  }
+
+  // The number of distinct strings in the pool
+  std::size_t size() const {
+    std::size_t result = 0;
+    for (const auto &shard : m_shards) {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      result += shard.strings.size();
+    }
+    return result;
+  }
+
+  // The memory used for the characters of the strings
+  std::size_t characters_size() const {
+    std::size_t result = 0;
+    for (const auto &shard : m_shards) {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      result += shard.used;
+    }
+    return result;
+  }
+
+private:
+  static constexpr std::size_t shard_count = 16;
+  static constexpr std::size_t max_shard_size =
+      (std::size_t(UINT32_MAX) + 1) / shard_count;
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+  struct shard_t {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string_view, id_t> ids;
+    std::vector<std::string_view> strings;
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char *next = nullptr;
+    std::size_t chunk_left = 0;
+    std::size_t used = 0;
+
+    std::string_view store(std::string_view value) {
+      if (value.empty()) {
+        return {};
+      }
+      if (value.size() > chunk_left) {
+        // Strings longer than a chunk get a chunk of their own
+        const auto size = std::max(chunk_size, value.size());
+        chunks.push_back(std::make_unique<char[]>(size));
+        next = chunks.back().get();
+        chunk_left = size;
+      }
+      const std::string_view result(next, value.size());
+      std::memcpy(next, value.data(), value.size());
+      next += value.size();
+      chunk_left -= value.size();
+      used += value.size();
+      return result;
+    }
+  };
+
+  std::array<shard_t, shard_count> m_shards;
+};
+
+#endif // NAME_POOL_H
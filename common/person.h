@@ -1,7 +1,13 @@
 #ifndef PERSON_H
 #define PERSON_H
 
+#include <ostream>
 #include <string>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 class person_t {
 public:
@@ -20,34 +26,51 @@ public:
         : m_name("John")
         , m_surname("Doe")
         , m_gender(other)
+        , m_age(0)
     {
     }
 
+    // The names are taken by value and moved into the member
+    // variables, so passing a temporary string does not copy it
     person_t(std::string name, gender_t gender, int age = 0)
-        : m_name(name)
+        : m_name(std::move(name))
         , m_surname("Doe")
         , m_gender(gender)
         , m_age(age)
     {
     }
 
-    person_t(std::string name, const std::string &surname, gender_t gender, int age = 0)
-        : m_name(name)
-        , m_surname(surname)
+    person_t(std::string name, std::string surname, gender_t gender, int age = 0)
+        : m_name(std::move(name))
+        , m_surname(std::move(surname))
         , m_gender(gender)
         , m_age(age)
     {
     }
 
-    std::string name() const
+    // The accessors return references to the member variables
+    // instead of copies, so calling them never allocates
+    const std::string &name() const
+    {
+        return m_name;
+    }
+
+    const std::string &surname() const
+    {
+        return m_surname;
+    }
+
+#if __cplusplus >= 201703L
+    std::string_view name_view() const
     {
         return m_name;
     }
 
-    std::string surname() const
+    std::string_view surname_view() const
     {
         return m_surname;
     }
+#endif
 
     gender_t gender() const
     {
@@ -0,0 +1,294 @@
+#ifndef PERSON_FILE_H
+#define PERSON_FILE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "person.h"
+#include "person_table.h"
+
+// A compact binary file format for collections of persons, meant
+// to be memory mapped and queried in place instead of being parsed.
+//
+// The file consists of three sections:
+//  - a header with the magic bytes, the format version and the sizes
+//    of the other sections,
+//  - the rows, one fixed-width person_file_row per person,
+//  - the string heap, with all the names and surnames. Every distinct
+//    string is stored only once, and the rows point into the heap.
+//
+// Opening a file maps it into memory, which takes the same time
+// for any number of persons -- the pages are read from disk only
+// when they are accessed. The mapping is shared, so all processes
+// that map the same file use the same physical memory.
+//
+// Integers are stored in the native byte order of the machine that
+// wrote the file, and the magic bytes are used to detect files
+// written on machines with a different one.
+
+struct person_file_header {
+    char magic[8];
+    std::uint32_t byte_order;
+    std::uint32_t version;
+    std::uint64_t row_count;
+    std::uint64_t heap_size;
+};
+
+struct person_file_row {
+    std::uint32_t name_offset;
+    std::uint32_t surname_offset;
+    std::uint16_t name_length;
+    std::uint16_t surname_length;
+    std::int32_t age;
+    std::uint8_t gender;
+    std::uint8_t reserved[3];
+};
+
+static_assert(sizeof(person_file_header) == 32, "unexpected header padding");
+static_assert(sizeof(person_file_row) == 20, "unexpected row padding");
+
+namespace person_file_format {
+    constexpr char magic[8] = {'F', 'P', 'C', 'P', 'P', 'L', 'E', '\0'};
+    constexpr std::uint32_t byte_order = 0x01020304;
+    constexpr std::uint32_t version = 1;
+}
+
+// Converts a collection of persons (person_t, person_view or anything
+// else with the same accessors) to the binary format
+template <typename It>
+void write_person_file(const std::string &path, It first, It last)
+{
+    std::vector<person_file_row> rows;
+    std::string heap;
+    std::unordered_map<std::string, std::uint32_t> offsets;
+
+    auto intern = [&](std::string_view value) {
+        if (value.size() > UINT16_MAX) {
+            throw std::length_error("name too long: " + std::string(value));
+        }
+        auto [it, inserted] = offsets.try_emplace(std::string(value),
+                static_cast<std::uint32_t>(heap.size()));
+        if (inserted) {
+            if (heap.size() + value.size() > UINT32_MAX) {
+                throw std::length_error("the string heap is full");
+            }
+            heap.append(value);
+        }
+        return it->second;
+    };
+
+    for (; first != last; ++first) {
+        const auto &person = *first;
+        const std::string_view name = person.name();
+        const std::string_view surname = person.surname();
+
+        person_file_row row{};
+        row.name_offset = intern(name);
+        row.name_length = static_cast<std::uint16_t>(name.size());
+        row.surname_offset = intern(surname);
+        row.surname_length = static_cast<std::uint16_t>(surname.size());
+        row.age = person.age();
+        row.gender = static_cast<std::uint8_t>(person.gender());
+        rows.push_back(row);
+    }
+
+    person_file_header header{};
+    std::memcpy(header.magic, person_file_format::magic, sizeof(header.magic));
+    header.byte_order = person_file_format::byte_order;
+    header.version = person_file_format::version;
+    header.row_count = rows.size();
+    header.heap_size = heap.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(rows.data()),
+              rows.size() * sizeof(person_file_row));
+    out.write(heap.data(), heap.size());
+    if (!out) {
+        throw std::runtime_error("can not write " + path);
+    }
+}
+
+template <typename C>
+void write_person_file(const std::string &path, const C &persons)
+{
+    write_person_file(path, std::begin(persons), std::end(persons));
+}
+
+// A read-only memory mapped person file. The rows are accessed
+// in place through person_view objects, nothing is copied.
+class mapped_person_file {
+public:
+    using const_iterator = row_iterator<mapped_person_file>;
+
+    explicit mapped_person_file(const std::string &path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "can not open " + path);
+        }
+
+        struct stat status;
+        if (::fstat(fd, &status) != 0) {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(),
+                                    "can not stat " + path);
+        }
+        m_size = static_cast<std::size_t>(status.st_size);
+
+        if (m_size < sizeof(person_file_header)) {
+            ::close(fd);
+            throw std::runtime_error(path + " is not a person file");
+        }
+
+        m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        const int error = errno;
+        // The mapping keeps the file alive, we do not need the descriptor
+        ::close(fd);
+        if (m_data == MAP_FAILED) {
+            m_data = nullptr;
+            throw std::system_error(error, std::generic_category(),
+                                    "can not map " + path);
+        }
+
+        // The sizes in the header are compared with what is left of the
+        // file, instead of being added up, so that they can not overflow
+        const auto header = static_cast<const person_file_header *>(m_data);
+        const std::size_t body_size = m_size - sizeof(person_file_header);
+        if (std::memcmp(header->magic, person_file_format::magic,
+                        sizeof(header->magic)) != 0 ||
+            header->byte_order != person_file_format::byte_order ||
+            header->version != person_file_format::version ||
+            header->row_count > body_size / sizeof(person_file_row) ||
+            header->heap_size != body_size - header->row_count *
+                                                sizeof(person_file_row)) {
+            unmap();
+            throw std::runtime_error(path + " is not a valid person file");
+        }
+
+        m_rows = reinterpret_cast<const person_file_row *>(header + 1);
+        m_row_count = header->row_count;
+        m_heap = reinterpret_cast<const char *>(m_rows + m_row_count);
+        m_heap_size = header->heap_size;
+    }
+
+    mapped_person_file(const mapped_person_file &) = delete;
+    mapped_person_file &operator=(const mapped_person_file &) = delete;
+
+    mapped_person_file(mapped_person_file &&other) noexcept
+        : m_data(other.m_data)
+        , m_size(other.m_size)
+        , m_rows(other.m_rows)
+        , m_row_count(other.m_row_count)
+        , m_heap(other.m_heap)
+        , m_heap_size(other.m_heap_size)
+    {
+        other.m_data = nullptr;
+    }
+
+    ~mapped_person_file()
+    {
+        unmap();
+    }
+
+    std::size_t size() const
+    {
+        return m_row_count;
+    }
+
+    bool empty() const
+    {
+        return m_row_count == 0;
+    }
+
+    // The rows are checked when they are accessed, and not when the file
+    // is opened, so that opening does not need to read all of them.
+    // Throws std::runtime_error when the names of the row are not
+    // in the string heap.
+    person_view operator[](std::size_t index) const
+    {
+        const auto &row = m_rows[index];
+        if (std::uint64_t(row.name_offset) + row.name_length > m_heap_size ||
+            std::uint64_t(row.surname_offset) + row.surname_length >
+                    m_heap_size) {
+            throw std::runtime_error("invalid row in a person file");
+        }
+        return person_view(
+                std::string_view(m_heap + row.name_offset, row.name_length),
+                std::string_view(m_heap + row.surname_offset, row.surname_length),
+                static_cast<person_t::gender_t>(row.gender),
+                row.age);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+    // Advises the kernel on how the file is going to be accessed,
+    // for example MADV_SEQUENTIAL for full scans, or MADV_WILLNEED
+    // to start reading it in the background
+    void advise(int advice) const
+    {
+        ::madvise(m_data, m_size, advice);
+    }
+
+private:
+    void unmap()
+    {
+        if (m_data) {
+            ::munmap(m_data, m_size);
+            m_data = nullptr;
+        }
+    }
+
+    void *m_data = nullptr;
+    std::size_t m_size = 0;
+    const person_file_row *m_rows = nullptr;
+    std::size_t m_row_count = 0;
+    const char *m_heap = nullptr;
+    std::uint64_t m_heap_size = 0;
+};
+
+inline mapped_person_file::const_iterator begin(const mapped_person_file &file)
+{
+    return file.begin();
+}
+
+inline mapped_person_file::const_iterator end(const mapped_person_file &file)
+{
+    return file.end();
+}
+
+inline mapped_person_file::const_iterator cbegin(const mapped_person_file &file)
+{
+    return file.begin();
+}
+
+inline mapped_person_file::const_iterator cend(const mapped_person_file &file)
+{
+    return file.end();
+}
+
+#endif // PERSON_FILE_H
@@ -0,0 +1,128 @@
+#ifndef PERSON_INDEX_H
+#define PERSON_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "person.h"
+#include "roaring.h"
+
+// Bitmap indexes over a collection of persons, for answering
+// gender and age questions without scanning the collection.
+//
+// Every person is identified by its position in the collection.
+// For every gender, and for every age, the index keeps a compressed
+// bitmap of the persons that have it. Predicates like older_than
+// become unions of age bitmaps, combining predicates is done with
+// bitwise &, | and -, and counting is popcount over the result:
+//
+//     auto females_over_42 = index.of_gender(person_t::female)
+//                          & index.older_than(42);
+//     females_over_42.cardinality();
+//
+// The index is updated incrementally when persons are inserted
+// or removed. Ages are bucketed one year per bucket, ages outside
+// of [0, max_age] go to the first or the last bucket.
+class person_index {
+public:
+    static constexpr int max_age = 150;
+
+    person_index() = default;
+
+    template <typename C>
+    explicit person_index(const C &persons)
+    {
+        std::uint32_t id = 0;
+        for (const auto &person : persons) {
+            insert(id++, person);
+        }
+    }
+
+    template <typename Person>
+    void insert(std::uint32_t id, const Person &person)
+    {
+        m_all.add(id);
+        m_genders[person.gender()].add(id);
+        m_ages[bucket(person.age())].add(id);
+    }
+
+    // The person needs to be the same as the one that was inserted
+    // with this id, so that we know which bitmaps contain it
+    template <typename Person>
+    void remove(std::uint32_t id, const Person &person)
+    {
+        m_all.remove(id);
+        m_genders[person.gender()].remove(id);
+        m_ages[bucket(person.age())].remove(id);
+    }
+
+    std::size_t size() const
+    {
+        return m_all.cardinality();
+    }
+
+    const roaring_bitmap &all() const
+    {
+        return m_all;
+    }
+
+    const roaring_bitmap &of_gender(person_t::gender_t gender) const
+    {
+        return m_genders[gender];
+    }
+
+    // Persons with the age in [min, max]
+    roaring_bitmap age_between(int min, int max) const
+    {
+        min = std::max(min, 0);
+        max = std::min(max, max_age);
+        if (min > max) {
+            return roaring_bitmap();
+        }
+        return roaring_bitmap::unite_all(m_ages.begin() + min,
+                                         m_ages.begin() + max + 1);
+    }
+
+    roaring_bitmap older_than(int limit) const
+    {
+        return age_between(limit + 1, max_age);
+    }
+
+    roaring_bitmap younger_than(int limit) const
+    {
+        return age_between(0, limit - 1);
+    }
+
+    // Negation, relative to the persons in the index
+    roaring_bitmap complement(const roaring_bitmap &persons) const
+    {
+        return m_all - persons;
+    }
+
+    std::size_t count_of_gender(person_t::gender_t gender) const
+    {
+        return m_genders[gender].cardinality();
+    }
+
+    std::size_t count_age_between(int min, int max) const
+    {
+        std::size_t result = 0;
+        for (int age = std::max(min, 0); age <= std::min(max, max_age); ++age) {
+            result += m_ages[age].cardinality();
+        }
+        return result;
+    }
+
+private:
+    static int bucket(int age)
+    {
+        return std::clamp(age, 0, max_age);
+    }
+
+    roaring_bitmap m_all;
+    std::array<roaring_bitmap, 3> m_genders;
+    std::array<roaring_bitmap, max_age + 1> m_ages;
+};
+
+#endif // PERSON_INDEX_H
@@ -0,0 +1,228 @@
+#ifndef PERSON_SORT_H
+#define PERSON_SORT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Sorting persons by age, then by surname, then by name.
+//
+// The persons themselves are not moved, the result is the order
+// in which they should be visited -- a vector of indices. This
+// works for any collection which has operator[] returning persons
+// (or person views), like std::vector<person_t>, person_table and
+// mapped_person_file, and is stable: persons with equal keys keep
+// their relative order.
+//
+// The sort has two passes:
+//  - a counting sort on the age, which splits the persons into
+//    a bucket per age. Every thread counts the ages in its part of
+//    the collection, and then moves its persons to their buckets,
+//    so this pass is parallel and does not compare anything;
+//  - the buckets are sorted by the names, each bucket by a single
+//    thread. The comparisons do not touch the persons, they use
+//    the first 8 bytes of the surname and the name, which are
+//    cached as big-endian integers in the sort keys, along with
+//    the lengths. Only when both prefixes are equal and one of the
+//    strings is longer than the prefix, the strings are compared.
+//
+// Ages are expected to be in a small range. When they are not,
+// all the persons end up in a single bucket sorted by one thread.
+
+namespace person_sort_detail {
+
+    struct sort_key {
+        std::uint64_t surname_prefix;
+        std::uint64_t name_prefix;
+        std::uint32_t index;
+        std::uint16_t surname_length;
+        std::uint16_t name_length;
+        int age;
+    };
+
+    // The first 8 bytes of the string, padded with zeros, in an order
+    // in which comparing the integers compares the strings
+    inline std::uint64_t prefix_of(std::string_view value)
+    {
+        unsigned char bytes[8] = {};
+        std::memcpy(bytes, value.data(),
+                    std::min<std::size_t>(8, value.size()));
+        std::uint64_t result = 0;
+        for (auto byte : bytes) {
+            result = (result << 8) | byte;
+        }
+        return result;
+    }
+
+    inline std::uint16_t length_of(std::string_view value)
+    {
+        return static_cast<std::uint16_t>(std::min<std::size_t>(
+                value.size(), std::numeric_limits<std::uint16_t>::max()));
+    }
+
+    // Compares two strings given their cached prefixes and lengths.
+    // Returns a negative number, zero or a positive number.
+    template <typename Full>
+    int compare_strings(std::uint64_t left_prefix, std::uint16_t left_length,
+                        std::uint64_t right_prefix, std::uint16_t right_length,
+                        Full full)
+    {
+        if (left_prefix != right_prefix) {
+            return left_prefix < right_prefix ? -1 : 1;
+        }
+        if (left_length <= 8 && right_length <= 8) {
+            // The strings are the prefixes, only the padding can differ
+            return int(left_length) - int(right_length);
+        }
+        return full();
+    }
+
+    template <typename F>
+    void in_parallel(unsigned int threads, F f)
+    {
+        std::vector<std::thread> workers;
+        for (unsigned int thread = 1; thread < threads; ++thread) {
+            workers.emplace_back(f, thread);
+        }
+        f(0u);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+} // namespace person_sort_detail
+
+template <typename Persons>
+std::vector<std::uint32_t> sorted_order(
+        const Persons &persons,
+        unsigned int threads =
+                std::max(1u, std::thread::hardware_concurrency()))
+{
+    using namespace person_sort_detail;
+
+    constexpr std::size_t min_chunk_size = 1 << 14;
+    constexpr long long max_age_range = 1 << 16;
+
+    const std::size_t size = persons.size();
+    threads = static_cast<unsigned int>(std::max<std::size_t>(1,
+                std::min<std::size_t>(threads, size / min_chunk_size)));
+    const auto chunk_size = (size + threads - 1) / threads;
+
+    auto chunk_first = [&](unsigned int thread) {
+        return std::min(size, thread * chunk_size);
+    };
+    auto chunk_last = [&](unsigned int thread) {
+        return std::min(size, (thread + 1) * chunk_size);
+    };
+
+    // Caching the keys, and finding the range of ages
+    std::vector<sort_key> keys(size);
+    std::vector<int> min_ages(threads, std::numeric_limits<int>::max());
+    std::vector<int> max_ages(threads, std::numeric_limits<int>::min());
+    in_parallel(threads, [&](unsigned int thread) {
+        for (auto i = chunk_first(thread); i < chunk_last(thread); ++i) {
+            const auto &person = persons[i];
+            const std::string_view surname = person.surname();
+            const std::string_view name = person.name();
+            const int age = person.age();
+            keys[i] = { prefix_of(surname), prefix_of(name),
+                        static_cast<std::uint32_t>(i),
+                        length_of(surname), length_of(name), age };
+            min_ages[thread] = std::min(min_ages[thread], age);
+            max_ages[thread] = std::max(max_ages[thread], age);
+        }
+    });
+
+    const int min_age =
+            size ? *std::min_element(min_ages.cbegin(), min_ages.cend()) : 0;
+    const int max_age =
+            size ? *std::max_element(max_ages.cbegin(), max_ages.cend()) : 0;
+    const bool bucketed =
+            static_cast<long long>(max_age) - min_age < max_age_range;
+    const std::size_t bucket_count =
+            bucketed ? std::size_t(max_age - min_age) + 1 : 1;
+
+    auto bucket_of = [&](const sort_key &key) -> std::size_t {
+        return bucketed ? std::size_t(key.age - min_age) : 0;
+    };
+
+    // Counting sort on the age. counts[thread][bucket] becomes the
+    // position where the thread puts its next person of that age.
+    std::vector<std::vector<std::size_t>> counts(
+            threads, std::vector<std::size_t>(bucket_count));
+    in_parallel(threads, [&](unsigned int thread) {
+        for (auto i = chunk_first(thread); i < chunk_last(thread); ++i) {
+            ++counts[thread][bucket_of(keys[i])];
+        }
+    });
+
+    std::vector<std::size_t> bucket_starts(bucket_count + 1);
+    std::size_t position = 0;
+    for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        bucket_starts[bucket] = position;
+        for (unsigned int thread = 0; thread < threads; ++thread) {
+            const auto count = counts[thread][bucket];
+            counts[thread][bucket] = position;
+            position += count;
+        }
+    }
+    bucket_starts[bucket_count] = size;
+
+    std::vector<sort_key> sorted(size);
+    in_parallel(threads, [&](unsigned int thread) {
+        for (auto i = chunk_first(thread); i < chunk_last(thread); ++i) {
+            sorted[counts[thread][bucket_of(keys[i])]++] = keys[i];
+        }
+    });
+    keys.clear();
+    keys.shrink_to_fit();
+
+    // Sorting the buckets by the names. The index is the last key,
+    // which makes the sort stable.
+    auto less = [&persons](const sort_key &left, const sort_key &right) {
+        if (left.age != right.age) {
+            return left.age < right.age;
+        }
+        const auto surnames = compare_strings(
+                left.surname_prefix, left.surname_length,
+                right.surname_prefix, right.surname_length, [&] {
+                    return std::string_view(persons[left.index].surname())
+                            .compare(persons[right.index].surname());
+                });
+        if (surnames != 0) {
+            return surnames < 0;
+        }
+        const auto names = compare_strings(
+                left.name_prefix, left.name_length,
+                right.name_prefix, right.name_length, [&] {
+                    return std::string_view(persons[left.index].name())
+                            .compare(persons[right.index].name());
+                });
+        if (names != 0) {
+            return names < 0;
+        }
+        return left.index < right.index;
+    };
+
+    std::atomic<std::size_t> next_bucket{0};
+    in_parallel(threads, [&](unsigned int) {
+        for (auto bucket = next_bucket++; bucket < bucket_count;
+             bucket = next_bucket++) {
+            std::sort(sorted.begin() + bucket_starts[bucket],
+                      sorted.begin() + bucket_starts[bucket + 1], less);
+        }
+    });
+
+    std::vector<std::uint32_t> result(size);
+    std::transform(sorted.cbegin(), sorted.cend(), result.begin(),
+                   [](const sort_key &key) { return key.index; });
+    return result;
+}
+
+#endif // PERSON_SORT_H
@@ -0,0 +1,479 @@
+#ifndef PERSON_TABLE_H
+#define PERSON_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "person.h"
+
+// A read-only view of a single person, with the same accessors as
+// person_t. The name and surname are views into a string storage
+// owned by someone else, so creating a view never allocates.
+class person_view {
+public:
+    person_view(std::string_view name, std::string_view surname,
+                person_t::gender_t gender, int age)
+        : m_name(name)
+        , m_surname(surname)
+        , m_gender(gender)
+        , m_age(age)
+    {
+    }
+
+    std::string_view name() const
+    {
+        return m_name;
+    }
+
+    std::string_view surname() const
+    {
+        return m_surname;
+    }
+
+    person_t::gender_t gender() const
+    {
+        return m_gender;
+    }
+
+    int age() const
+    {
+        return m_age;
+    }
+
+    person_t to_person() const
+    {
+        return person_t(std::string(m_name), std::string(m_surname),
+                        m_gender, m_age);
+    }
+
+    void print(std::ostream &out,
+               person_t::output_format_t format) const
+    {
+        if (format == person_t::name_only) {
+            out << name() << '\n';
+
+        } else if (format == person_t::full_name) {
+            out << name() << ' '
+                << surname() << '\n';
+
+        }
+    }
+
+private:
+    std::string_view m_name;
+    std::string_view m_surname;
+    person_t::gender_t m_gender;
+    int m_age;
+};
+
+// A random access iterator over the rows of a table-like collection
+// which has operator[] returning rows by value, like person_table.
+//
+// This is a proxy iterator: dereferencing it creates a person_view,
+// there is no person object in the table it could return a reference
+// to. It has all the operations of a random access iterator, and works
+// with the algorithms that only read the rows, but the rows can not be
+// swapped or assigned through it, so it can not be used for sorting.
+template <typename Table>
+class row_iterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = person_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = person_view;
+
+    row_iterator(const Table *table, std::size_t index)
+        : m_table(table)
+        , m_index(index)
+    {
+    }
+
+    person_view operator*() const
+    {
+        return (*m_table)[m_index];
+    }
+
+    person_view operator[](difference_type offset) const
+    {
+        return (*m_table)[m_index + offset];
+    }
+
+    row_iterator &operator++()
+    {
+        ++m_index;
+        return *this;
+    }
+
+    row_iterator operator++(int)
+    {
+        auto result = *this;
+        ++m_index;
+        return result;
+    }
+
+    row_iterator &operator--()
+    {
+        --m_index;
+        return *this;
+    }
+
+    row_iterator operator--(int)
+    {
+        auto result = *this;
+        --m_index;
+        return result;
+    }
+
+    row_iterator &operator+=(difference_type offset)
+    {
+        m_index += offset;
+        return *this;
+    }
+
+    row_iterator &operator-=(difference_type offset)
+    {
+        m_index -= offset;
+        return *this;
+    }
+
+    friend row_iterator operator+(row_iterator it, difference_type offset)
+    {
+        return it += offset;
+    }
+
+    friend row_iterator operator-(row_iterator it, difference_type offset)
+    {
+        return it -= offset;
+    }
+
+    friend row_iterator operator+(difference_type offset, row_iterator it)
+    {
+        return it += offset;
+    }
+
+    friend difference_type operator-(const row_iterator &left,
+                                     const row_iterator &right)
+    {
+        return static_cast<difference_type>(left.m_index) -
+               static_cast<difference_type>(right.m_index);
+    }
+
+    friend bool operator==(const row_iterator &left,
+                           const row_iterator &right)
+    {
+        return left.m_index == right.m_index;
+    }
+
+    friend bool operator!=(const row_iterator &left,
+                           const row_iterator &right)
+    {
+        return left.m_index != right.m_index;
+    }
+
+    friend bool operator<(const row_iterator &left,
+                          const row_iterator &right)
+    {
+        return left.m_index < right.m_index;
+    }
+
+    friend bool operator>(const row_iterator &left,
+                          const row_iterator &right)
+    {
+        return left.m_index > right.m_index;
+    }
+
+    friend bool operator<=(const row_iterator &left,
+                           const row_iterator &right)
+    {
+        return left.m_index <= right.m_index;
+    }
+
+    friend bool operator>=(const row_iterator &left,
+                           const row_iterator &right)
+    {
+        return left.m_index >= right.m_index;
+    }
+
+private:
+    const Table *m_table;
+    std::size_t m_index;
+};
+
+// A collection of persons stored as a structure of arrays.
+//
+// In a std::vector<person_t>, every person takes two std::string
+// objects, the gender and the age, so a predicate that only needs
+// the age pulls all the other fields through the cache as well.
+// Here every field has its own column: genders are stored as bytes,
+// ages as ints, and names and surnames are concatenated into two
+// string arenas, with an array of offsets telling where each of them
+// starts. The rows are accessed through person_view objects.
+//
+// The arena offsets are 32-bit, so each arena can hold up to 4GB
+// of names, push_back throws std::length_error when it would not fit.
+class person_table {
+public:
+    using const_iterator = row_iterator<person_table>;
+
+    person_table() = default;
+
+    template <typename It>
+    person_table(It first, It last)
+    {
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    explicit person_table(const std::vector<person_t> &persons)
+        : person_table(persons.cbegin(), persons.cend())
+    {
+    }
+
+    void reserve(std::size_t size)
+    {
+        m_genders.reserve(size);
+        m_ages.reserve(size);
+        m_name_offsets.reserve(size + 1);
+        m_surname_offsets.reserve(size + 1);
+    }
+
+    void push_back(std::string_view name, std::string_view surname,
+                   person_t::gender_t gender, int age)
+    {
+        if (m_names.size() + name.size() > UINT32_MAX ||
+            m_surnames.size() + surname.size() > UINT32_MAX) {
+            throw std::length_error("the person table is full");
+        }
+
+        m_genders.push_back(static_cast<std::uint8_t>(gender));
+        m_ages.push_back(age);
+        m_names.append(name);
+        m_name_offsets.push_back(static_cast<std::uint32_t>(m_names.size()));
+        m_surnames.append(surname);
+        m_surname_offsets.push_back(static_cast<std::uint32_t>(m_surnames.size()));
+    }
+
+    template <typename Person>
+    void push_back(const Person &person)
+    {
+        push_back(person.name(), person.surname(), person.gender(),
+                  person.age());
+    }
+
+    std::size_t size() const
+    {
+        return m_ages.size();
+    }
+
+    bool empty() const
+    {
+        return m_ages.empty();
+    }
+
+    person_view operator[](std::size_t index) const
+    {
+        return person_view(name(index), surname(index),
+                           gender(index), age(index));
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+    // Accessing a single field does not touch the other columns
+    std::string_view name(std::size_t index) const
+    {
+        return std::string_view(m_names).substr(
+                m_name_offsets[index],
+                m_name_offsets[index + 1] - m_name_offsets[index]);
+    }
+
+    std::string_view surname(std::size_t index) const
+    {
+        return std::string_view(m_surnames).substr(
+                m_surname_offsets[index],
+                m_surname_offsets[index + 1] - m_surname_offsets[index]);
+    }
+
+    person_t::gender_t gender(std::size_t index) const
+    {
+        return static_cast<person_t::gender_t>(m_genders[index]);
+    }
+
+    int age(std::size_t index) const
+    {
+        return m_ages[index];
+    }
+
+    // The columns themselves
+    const std::vector<std::uint8_t> &genders() const
+    {
+        return m_genders;
+    }
+
+    const std::vector<int> &ages() const
+    {
+        return m_ages;
+    }
+
+private:
+    std::vector<std::uint8_t> m_genders;
+    std::vector<int> m_ages;
+    std::string m_names;
+    std::vector<std::uint32_t> m_name_offsets{0};
+    std::string m_surnames;
+    std::vector<std::uint32_t> m_surname_offsets{0};
+};
+
+inline person_table::const_iterator begin(const person_table &table)
+{
+    return table.begin();
+}
+
+inline person_table::const_iterator end(const person_table &table)
+{
+    return table.end();
+}
+
+inline person_table::const_iterator cbegin(const person_table &table)
+{
+    return table.begin();
+}
+
+inline person_table::const_iterator cend(const person_table &table)
+{
+    return table.end();
+}
+
+// Column scans. They only read the column they need, and process
+// 4 ages or 16 genders at a time using SSE2 when it is available.
+
+// Calls the function with the index of every person older than the limit
+template <typename F>
+void for_each_older_than(const person_table &table, int limit, F f)
+{
+    const auto &ages = table.ages();
+    const auto size = ages.size();
+    std::size_t i = 0;
+
+#ifdef __SSE2__
+    const auto limits = _mm_set1_epi32(limit);
+    for (; i + 4 <= size; i += 4) {
+        const auto values = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(ages.data() + i));
+        auto mask = _mm_movemask_ps(
+                _mm_castsi128_ps(_mm_cmpgt_epi32(values, limits)));
+        while (mask) {
+            f(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (ages[i] > limit) {
+            f(i);
+        }
+    }
+}
+
+// Calls the function with the index of every person of the given gender
+template <typename F>
+void for_each_of_gender(const person_table &table, person_t::gender_t gender,
+                        F f)
+{
+    const auto &genders = table.genders();
+    const auto size = genders.size();
+    const auto value = static_cast<std::uint8_t>(gender);
+    std::size_t i = 0;
+
+#ifdef __SSE2__
+    const auto values = _mm_set1_epi8(static_cast<char>(value));
+    for (; i + 16 <= size; i += 16) {
+        const auto column = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(genders.data() + i));
+        auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(column, values));
+        while (mask) {
+            f(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (genders[i] == value) {
+            f(i);
+        }
+    }
+}
+
+inline std::size_t count_older_than(const person_table &table, int limit)
+{
+    const auto &ages = table.ages();
+    const auto size = ages.size();
+    std::size_t result = 0;
+    std::size_t i = 0;
+
+#ifdef __SSE2__
+    const auto limits = _mm_set1_epi32(limit);
+    for (; i + 4 <= size; i += 4) {
+        const auto values = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(ages.data() + i));
+        result += __builtin_popcount(_mm_movemask_ps(
+                _mm_castsi128_ps(_mm_cmpgt_epi32(values, limits))));
+    }
+#endif
+
+    for (; i < size; ++i) {
+        result += ages[i] > limit;
+    }
+    return result;
+}
+
+inline std::size_t count_of_gender(const person_table &table,
+                                   person_t::gender_t gender)
+{
+    std::size_t result = 0;
+    for_each_of_gender(table, gender, [&result](std::size_t) { ++result; });
+    return result;
+}
+
+inline std::vector<std::uint32_t> select_older_than(const person_table &table,
+                                                    int limit)
+{
+    std::vector<std::uint32_t> result;
+    for_each_older_than(table, limit, [&result](std::size_t index) {
+        result.push_back(static_cast<std::uint32_t>(index));
+    });
+    return result;
+}
+
+inline std::vector<std::uint32_t> select_of_gender(const person_table &table,
+                                                   person_t::gender_t gender)
+{
+    std::vector<std::uint32_t> result;
+    for_each_of_gender(table, gender, [&result](std::size_t index) {
+        result.push_back(static_cast<std::uint32_t>(index));
+    });
+    return result;
+}
+
+#endif // PERSON_TABLE_H
@@ -0,0 +1,138 @@
+#ifndef PERSON_WRITER_H
+#define PERSON_WRITER_H
+
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#include "person.h"
+
+// Writing many persons at once, without an ostream.
+//
+// Every operator<< on an ostream constructs a sentry, checks the state
+// of the stream and goes through the locale, and that is paid for every
+// name, space and newline that is printed. buffered_writer copies the
+// text into a large buffer instead, converts numbers with to_chars,
+// and hands the whole buffer to the kernel with a single write when
+// it is full -- so printing a million persons takes a few hundred
+// system calls, and nothing else but copying the names.
+//
+// The writer does not own the file descriptor. It writes what is left
+// in the buffer when it is destroyed, but since the errors can not be
+// reported from the destructor, flush() should be called first.
+class buffered_writer {
+public:
+    explicit buffered_writer(int fd, std::size_t capacity = 1 << 16)
+        : m_fd(fd)
+    {
+        m_buffer.reserve(capacity);
+    }
+
+    buffered_writer(const buffered_writer &) = delete;
+    buffered_writer &operator=(const buffered_writer &) = delete;
+
+    ~buffered_writer()
+    {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    buffered_writer &append(std::string_view text)
+    {
+        if (m_buffer.size() + text.size() > m_buffer.capacity()) {
+            flush();
+            if (text.size() > m_buffer.capacity()) {
+                write_all(text.data(), text.size());
+                return *this;
+            }
+        }
+        m_buffer.insert(m_buffer.end(), text.begin(), text.end());
+        return *this;
+    }
+
+    buffered_writer &append(char c)
+    {
+        if (m_buffer.size() == m_buffer.capacity()) {
+            flush();
+        }
+        m_buffer.push_back(c);
+        return *this;
+    }
+
+    template <typename T,
+              typename = std::enable_if_t<std::is_integral_v<T> &&
+                                          !std::is_same_v<T, char> &&
+                                          !std::is_same_v<T, bool>>>
+    buffered_writer &append(T value)
+    {
+        // Enough for any 64-bit integer, with the sign
+        char digits[24];
+        const auto result =
+                std::to_chars(std::begin(digits), std::end(digits), value);
+        return append(std::string_view(digits, result.ptr - digits));
+    }
+
+    // Writes everything that is in the buffer
+    void flush()
+    {
+        write_all(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+private:
+    void write_all(const char *data, std::size_t size)
+    {
+        while (size > 0) {
+            const auto written = ::write(m_fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(),
+                                        "can not write the persons");
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+    int m_fd;
+    std::vector<char> m_buffer;
+};
+
+// The same output as person_t::print, for person_t, person_view
+// or anything else with the same accessors
+template <typename Person>
+void write_person(buffered_writer &out, const Person &person,
+                  person_t::output_format_t format)
+{
+    if (format == person_t::name_only) {
+        out.append(std::string_view(person.name())).append('\n');
+
+    } else if (format == person_t::full_name) {
+        out.append(std::string_view(person.name()))
+           .append(' ')
+           .append(std::string_view(person.surname()))
+           .append('\n');
+    }
+}
+
+template <typename It>
+void write_persons(buffered_writer &out, It first, It last,
+                   person_t::output_format_t format)
+{
+    for (; first != last; ++first) {
+        write_person(out, *first, format);
+    }
+}
+
+#endif // PERSON_WRITER_H
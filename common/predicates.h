@@ -0,0 +1,375 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "person.h"
+#include "person_table.h"
+
+// Predicates over persons, composed from smaller ones at compile time.
+//
+// Instead of writing a new lambda for every combination of older_than,
+// is_female and friends, the conditions are written as expressions:
+//
+//     using namespace predicates;
+//     auto selected = age > 42 && gender == person_t::female;
+//
+// Every comparison and every && || ! creates a small object whose type
+// describes the whole expression (an expression template), so the
+// compiler sees the complete predicate and inlines it into one function.
+// The operands of && and || are always both evaluated and combined with
+// bitwise operators, so there are no branches which the processor could
+// mispredict -- the comparisons are cheaper than the mispredictions.
+//
+// Every predicate can be called with a single person (person_t,
+// person_view or anything with the same accessors). Over a person_table,
+// it can also be evaluated for 16 persons at once: it returns a 16-bit
+// mask with a bit for every person, the ages are compared four at a time
+// and the genders sixteen at a time using SSE2, and the masks are combined
+// with the same bitwise operators.
+//
+// age and gender read the table columns directly. Other properties of
+// the persons can be used through project(), and existing predicates
+// (like older_than from chapter 3) through lift(). These are evaluated
+// for one person at a time, even in the 16-person batches.
+namespace predicates {
+
+// The number of persons a batch evaluation checks at once
+constexpr std::size_t batch_size = 16;
+constexpr std::uint32_t full_batch = (1u << batch_size) - 1;
+
+struct predicate_tag {};
+
+template <typename T>
+constexpr bool is_predicate_v =
+    std::is_base_of_v<predicate_tag, std::decay_t<T>>;
+
+enum class comparison {
+  less,
+  less_equal,
+  greater,
+  greater_equal,
+  equal,
+  not_equal
+};
+
+template <comparison Comparison, typename L, typename R>
+constexpr bool compare(const L &left, const R &right) {
+  if constexpr (Comparison == comparison::less) {
+    return left < right;
+  } else if constexpr (Comparison == comparison::less_equal) {
+    return left <= right;
+  } else if constexpr (Comparison == comparison::greater) {
+    return left > right;
+  } else if constexpr (Comparison == comparison::greater_equal) {
+    return left >= right;
+  } else if constexpr (Comparison == comparison::equal) {
+    return left == right;
+  } else {
+    return left != right;
+  }
+}
+
+// Evaluates a predicate for 16 consecutive persons of a table
+// one person at a time
+template <typename P>
+std::uint32_t scalar_mask(const P &predicate, const person_table &table,
+                          std::size_t first) {
+  std::uint32_t result = 0;
+  for (std::size_t i = 0; i < batch_size; ++i) {
+    result |= std::uint32_t(predicate(table[first + i])) << i;
+  }
+  return result;
+}
+
+template <typename Left, typename Right>
+struct and_t : predicate_tag {
+  Left left;
+  Right right;
+
+  template <typename T> bool operator()(const T &person) const {
+    return bool(left(person)) & bool(right(person));
+  }
+
+  std::uint32_t mask(const person_table &table, std::size_t first) const {
+    return left.mask(table, first) & right.mask(table, first);
+  }
+};
+
+template <typename Left, typename Right>
+struct or_t : predicate_tag {
+  Left left;
+  Right right;
+
+  template <typename T> bool operator()(const T &person) const {
+    return bool(left(person)) | bool(right(person));
+  }
+
+  std::uint32_t mask(const person_table &table, std::size_t first) const {
+    return left.mask(table, first) | right.mask(table, first);
+  }
+};
+
+template <typename Predicate>
+struct not_t : predicate_tag {
+  Predicate predicate;
+
+  template <typename T> bool operator()(const T &person) const {
+    return !predicate(person);
+  }
+
+  std::uint32_t mask(const person_table &table, std::size_t first) const {
+    return ~predicate.mask(table, first) & full_batch;
+  }
+};
+
+template <typename Left, typename Right,
+          typename = std::enable_if_t<is_predicate_v<Left> &&
+                                      is_predicate_v<Right>>>
+constexpr auto operator&&(Left left, Right right) {
+  return and_t<Left, Right>{{}, std::move(left), std::move(right)};
+}
+
+template <typename Left, typename Right,
+          typename = std::enable_if_t<is_predicate_v<Left> &&
+                                      is_predicate_v<Right>>>
+constexpr auto operator||(Left left, Right right) {
+  return or_t<Left, Right>{{}, std::move(left), std::move(right)};
+}
+
+template <typename Predicate,
+          typename = std::enable_if_t<is_predicate_v<Predicate>>>
+constexpr auto operator!(Predicate predicate) {
+  return not_t<Predicate>{{}, std::move(predicate)};
+}
+
+// Comparing the age column with a value
+template <comparison Comparison>
+struct age_compare : predicate_tag {
+  int value;
+
+  template <typename T> bool operator()(const T &person) const {
+    return compare<Comparison>(person.age(), value);
+  }
+
+  std::uint32_t mask(const person_table &table, std::size_t first) const {
+#ifdef __SSE2__
+    const int *ages = table.ages().data() + first;
+    const auto values = _mm_set1_epi32(value);
+    std::uint32_t result = 0;
+    for (std::size_t part = 0; part < batch_size / 4; ++part) {
+      const auto column = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(ages + 4 * part));
+
+      // SSE2 only has the less, greater and equal comparisons,
+      // the others are their negations
+      __m128i matches;
+      if constexpr (Comparison == comparison::less ||
+                    Comparison == comparison::greater_equal) {
+        matches = _mm_cmplt_epi32(column, values);
+      } else if constexpr (Comparison == comparison::greater ||
+                           Comparison == comparison::less_equal) {
+        matches = _mm_cmpgt_epi32(column, values);
+      } else {
+        matches = _mm_cmpeq_epi32(column, values);
+      }
+      result |= std::uint32_t(_mm_movemask_ps(_mm_castsi128_ps(matches)))
+                << (4 * part);
+    }
+
+    if constexpr (Comparison == comparison::greater_equal ||
+                  Comparison == comparison::less_equal ||
+                  Comparison == comparison::not_equal) {
+      result = ~result & full_batch;
+    }
+    return result;
+#else
+    return scalar_mask(*this, table, first);
+#endif
+  }
+};
+
+// Comparing the gender column with a value
+template <comparison Comparison>
+struct gender_compare : predicate_tag {
+  person_t::gender_t value;
+
+  template <typename T> bool operator()(const T &person) const {
+    return compare<Comparison>(person.gender(), value);
+  }
+
+  std::uint32_t mask(const person_table &table, std::size_t first) const {
+#ifdef __SSE2__
+    const auto column = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(table.genders().data() + first));
+    const auto values = _mm_set1_epi8(static_cast<char>(value));
+    const auto result =
+        std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(column, values)));
+    if constexpr (Comparison == comparison::equal) {
+      return result;
+    } else {
+      return ~result & full_batch;
+    }
+#else
+    return scalar_mask(*this, table, first);
+#endif
+  }
+};
+
+// Comparing a projection of a person with a value
+template <comparison Comparison, typename Projection, typename Value>
+struct projection_compare : predicate_tag {
+  Projection projection;
+  Value value;
+
+  template <typename T> bool operator()(const T &person) const {
+    return compare<Comparison>(projection(person), value);
+  }
+
+  std::uint32_t mask(const person_table &table, std::size_t first) const {
+    return scalar_mask(*this, table, first);
+  }
+};
+
+// An existing predicate, made composable
+template <typename F>
+struct lifted_t : predicate_tag {
+  F predicate;
+
+  template <typename T> bool operator()(const T &person) const {
+    return predicate(person);
+  }
+
+  std::uint32_t mask(const person_table &table, std::size_t first) const {
+    return scalar_mask(*this, table, first);
+  }
+};
+
+template <typename F> constexpr auto lift(F predicate) {
+  return lifted_t<F>{{}, std::move(predicate)};
+}
+
+// The fields which can be compared with values. age and gender
+// know how to read the table columns, projections do not.
+struct age_field {};
+struct gender_field {};
+
+template <typename Projection> struct projection_t {
+  Projection projection;
+};
+
+constexpr age_field age{};
+constexpr gender_field gender{};
+
+template <typename Projection> constexpr auto project(Projection projection) {
+  return projection_t<Projection>{std::move(projection)};
+}
+
+// Ages can be compared in every way. The value can be on either side,
+// `age > 42` and `42 < age` are the same predicate.
+constexpr auto operator<(age_field, int value) {
+  return age_compare<comparison::less>{{}, value};
+}
+constexpr auto operator<=(age_field, int value) {
+  return age_compare<comparison::less_equal>{{}, value};
+}
+constexpr auto operator>(age_field, int value) {
+  return age_compare<comparison::greater>{{}, value};
+}
+constexpr auto operator>=(age_field, int value) {
+  return age_compare<comparison::greater_equal>{{}, value};
+}
+constexpr auto operator==(age_field, int value) {
+  return age_compare<comparison::equal>{{}, value};
+}
+constexpr auto operator!=(age_field, int value) {
+  return age_compare<comparison::not_equal>{{}, value};
+}
+constexpr auto operator<(int value, age_field field) { return field > value; }
+constexpr auto operator<=(int value, age_field field) { return field >= value; }
+constexpr auto operator>(int value, age_field field) { return field < value; }
+constexpr auto operator>=(int value, age_field field) { return field <= value; }
+constexpr auto operator==(int value, age_field field) { return field == value; }
+constexpr auto operator!=(int value, age_field field) { return field != value; }
+
+// Genders can only be compared for equality
+constexpr auto operator==(gender_field, person_t::gender_t value) {
+  return gender_compare<comparison::equal>{{}, value};
+}
+constexpr auto operator!=(gender_field, person_t::gender_t value) {
+  return gender_compare<comparison::not_equal>{{}, value};
+}
+
+#define PREDICATES_PROJECTION_OPERATOR(Operator, Comparison)                   \
+  template <typename Projection, typename Value>                               \
+  constexpr auto operator Operator(projection_t<Projection> field,             \
+                                   Value value) {                              \
+    return projection_compare<Comparison, Projection, Value>{                  \
+        {}, std::move(field.projection), std::move(value)};                    \
+  }
+
+PREDICATES_PROJECTION_OPERATOR(<, comparison::less)
+PREDICATES_PROJECTION_OPERATOR(<=, comparison::less_equal)
+PREDICATES_PROJECTION_OPERATOR(>, comparison::greater)
+PREDICATES_PROJECTION_OPERATOR(>=, comparison::greater_equal)
+PREDICATES_PROJECTION_OPERATOR(==, comparison::equal)
+PREDICATES_PROJECTION_OPERATOR(!=, comparison::not_equal)
+
+#undef PREDICATES_PROJECTION_OPERATOR
+
+// Calls the function with the index of every person in the table
+// that satisfies the predicate, checking 16 persons at a time
+template <typename P, typename F,
+          typename = std::enable_if_t<is_predicate_v<P>>>
+void for_each_matching(const person_table &table, const P &predicate, F f) {
+  const auto size = table.size();
+  std::size_t i = 0;
+  for (; i + batch_size <= size; i += batch_size) {
+    auto mask = predicate.mask(table, i);
+    while (mask) {
+      f(i + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+  for (; i < size; ++i) {
+    if (predicate(table[i])) {
+      f(i);
+    }
+  }
+}
+
+template <typename P, typename = std::enable_if_t<is_predicate_v<P>>>
+std::size_t count_if(const person_table &table, const P &predicate) {
+  const auto size = table.size();
+  std::size_t result = 0;
+  std::size_t i = 0;
+  for (; i + batch_size <= size; i += batch_size) {
+    result += __builtin_popcount(predicate.mask(table, i));
+  }
+  for (; i < size; ++i) {
+    result += bool(predicate(table[i]));
+  }
+  return result;
+}
+
+template <typename P, typename = std::enable_if_t<is_predicate_v<P>>>
+std::vector<std::uint32_t> select(const person_table &table,
+                                  const P &predicate) {
+  std::vector<std::uint32_t> result;
+  for_each_matching(table, predicate, [&result](std::size_t index) {
+    result.push_back(static_cast<std::uint32_t>(index));
+  });
+  return result;
+}
+
+} // namespace predicates
+
+#endif // PREDICATES_H
@@ -0,0 +1,290 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "person.h"
+#include "person_table.h"
+#include "predicates.h"
+
+// Declarative queries over a person_table.
+//
+// A query is built step by step, and every step returns a new query
+// whose type records everything that was asked for:
+//
+//     using namespace predicates;
+//     const auto by_gender = query::from(table)
+//                                .where(age > 42)
+//                                .group_by(query::gender_groups())
+//                                .aggregate();
+//
+// Since the whole pipeline is known at compile time, running it is
+// a single loop with everything inlined. The loop goes through the
+// table 16 rows at a time: the filter is evaluated for the whole
+// batch with the predicates from predicates.h, which use SIMD to
+// read the columns, and only the matching rows are grouped and
+// aggregated. Only the columns the query needs are read.
+//
+// Large tables are split into a part per thread, every thread
+// aggregates its part into its own groups, and the groups are then
+// merged. Projections keep the order of the rows.
+namespace query {
+
+// The aggregates of a group of persons
+struct group_stats {
+  std::size_t count = 0;
+  long long age_sum = 0;
+  int min_age = 0;
+  int max_age = 0;
+
+  double average_age() const {
+    return count ? static_cast<double>(age_sum) / count : 0.0;
+  }
+
+  void add(int age) {
+    min_age = count ? std::min(min_age, age) : age;
+    max_age = count ? std::max(max_age, age) : age;
+    age_sum += age;
+    ++count;
+  }
+
+  void merge(const group_stats &other) {
+    if (other.count == 0) {
+      return;
+    }
+    min_age = count ? std::min(min_age, other.min_age) : other.min_age;
+    max_age = count ? std::max(max_age, other.max_age) : other.max_age;
+    age_sum += other.age_sum;
+    count += other.count;
+  }
+};
+
+// Groupings assign a group to every row of a table
+
+// All the rows in a single group
+struct no_groups {
+  std::size_t group_count() const { return 1; }
+
+  std::size_t group_of(const person_table &, std::size_t) const { return 0; }
+};
+
+// A group per gender, indexed by person_t::gender_t
+struct gender_groups {
+  std::size_t group_count() const { return 3; }
+
+  std::size_t group_of(const person_table &table, std::size_t row) const {
+    return table.genders()[row];
+  }
+};
+
+// Groups of ages [0, width), [width, 2 * width) and so on, up to
+// max_age. Younger persons are put into the first group, older
+// into the last one.
+struct age_groups {
+  int width = 10;
+  int max_age = 150;
+
+  std::size_t group_count() const { return max_age / width + 1; }
+
+  std::size_t group_of(const person_table &table, std::size_t row) const {
+    const auto age = std::clamp(table.ages()[row], 0, max_age);
+    return static_cast<std::size_t>(age / width);
+  }
+};
+
+// The predicate of a query without a filter
+struct everyone_t : predicates::predicate_tag {
+  template <typename T> bool operator()(const T &) const { return true; }
+
+  std::uint32_t mask(const person_table &, std::size_t) const {
+    return predicates::full_batch;
+  }
+};
+
+template <typename Predicate = everyone_t, typename Grouping = no_groups>
+class query_t {
+public:
+  query_t(const person_table &table, Predicate predicate = {},
+          Grouping grouping = {},
+          unsigned int threads =
+              std::max(1u, std::thread::hardware_concurrency()))
+      : m_table(&table), m_predicate(std::move(predicate)),
+        m_grouping(std::move(grouping)), m_threads(threads) {}
+
+  // Keeps only the rows which satisfy the predicate. Calling where
+  // several times is the same as joining the predicates with &&.
+  template <typename P> auto where(P predicate) const {
+    static_assert(predicates::is_predicate_v<P>,
+                  "where needs a predicate from predicates.h");
+    if constexpr (std::is_same_v<Predicate, everyone_t>) {
+      return query_t<P, Grouping>(*m_table, std::move(predicate), m_grouping,
+                                  m_threads);
+    } else {
+      using namespace predicates;
+      auto joined = m_predicate && std::move(predicate);
+      return query_t<decltype(joined), Grouping>(*m_table, std::move(joined),
+                                                 m_grouping, m_threads);
+    }
+  }
+
+  template <typename G> auto group_by(G grouping) const {
+    return query_t<Predicate, G>(*m_table, m_predicate, std::move(grouping),
+                                 m_threads);
+  }
+
+  // The number of threads to use, 1 runs the query on the calling thread
+  query_t threads(unsigned int threads) const {
+    auto result = *this;
+    result.m_threads = std::max(1u, threads);
+    return result;
+  }
+
+  // The aggregates of every group
+  std::vector<group_stats> aggregate() const {
+    const auto group_count = m_grouping.group_count();
+    std::vector<std::vector<group_stats>> partial(
+        m_threads, std::vector<group_stats>(group_count));
+
+    run([&](unsigned int thread, std::size_t row) {
+      partial[thread][m_grouping.group_of(*m_table, row)].add(
+          m_table->ages()[row]);
+    });
+
+    auto result = std::move(partial[0]);
+    for (std::size_t thread = 1; thread < partial.size(); ++thread) {
+      for (std::size_t group = 0; group < group_count; ++group) {
+        result[group].merge(partial[thread][group]);
+      }
+    }
+    return result;
+  }
+
+  // The number of matching rows in every group
+  std::vector<std::size_t> count_by_group() const {
+    std::vector<std::size_t> result;
+    for (const auto &group : aggregate()) {
+      result.push_back(group.count);
+    }
+    return result;
+  }
+
+  // The number of matching rows, ignoring the groups
+  std::size_t count() const {
+    std::vector<std::size_t> partial(m_threads);
+    run_batches([&](unsigned int thread, std::size_t, std::uint32_t mask) {
+      partial[thread] += __builtin_popcount(mask);
+    });
+    std::size_t result = 0;
+    for (auto count : partial) {
+      result += count;
+    }
+    return result;
+  }
+
+  double average_age() const {
+    return group_by(no_groups{}).aggregate()[0].average_age();
+  }
+
+  // The indices of the matching rows
+  std::vector<std::uint32_t> rows() const {
+    return collect([](std::size_t row) {
+      return static_cast<std::uint32_t>(row);
+    });
+  }
+
+  // Calls f with a person_view of every matching row and collects
+  // the results, in the order of the rows
+  template <typename F> auto project(F f) const {
+    return collect([&](std::size_t row) { return f((*m_table)[row]); });
+  }
+
+private:
+  template <typename F> auto collect(F f) const {
+    using value_type = std::decay_t<decltype(f(std::size_t{}))>;
+    std::vector<std::vector<value_type>> partial(m_threads);
+    run([&](unsigned int thread, std::size_t row) {
+      partial[thread].push_back(f(row));
+    });
+
+    auto result = std::move(partial[0]);
+    for (std::size_t thread = 1; thread < partial.size(); ++thread) {
+      result.insert(result.end(),
+                    std::make_move_iterator(partial[thread].begin()),
+                    std::make_move_iterator(partial[thread].end()));
+    }
+    return result;
+  }
+
+  // Rows per thread below which it is not worth starting threads
+  static constexpr std::size_t min_rows_per_thread = 1 << 16;
+
+  // Calls f(thread, first, mask) for every batch of rows, the bits
+  // of the mask tell which of the rows starting at first matched.
+  // The parts are aligned to the batch size, only the last part
+  // can end with an incomplete batch.
+  template <typename F> void run_batches(F f) const {
+    using predicates::batch_size;
+
+    const auto size = m_table->size();
+    const auto threads = static_cast<unsigned int>(std::max<std::size_t>(
+        1, std::min<std::size_t>(m_threads, size / min_rows_per_thread)));
+    const auto batches = (size + batch_size - 1) / batch_size;
+    const auto part_size = (batches + threads - 1) / threads * batch_size;
+
+    auto run_part = [&](unsigned int thread) {
+      const auto first = std::min(size, thread * part_size);
+      const auto last = std::min(size, first + part_size);
+      std::size_t i = first;
+      for (; i + batch_size <= last; i += batch_size) {
+        if (const auto mask = m_predicate.mask(*m_table, i)) {
+          f(thread, i, mask);
+        }
+      }
+      std::uint32_t mask = 0;
+      for (std::size_t j = i; j < last; ++j) {
+        mask |= std::uint32_t(bool(m_predicate((*m_table)[j]))) << (j - i);
+      }
+      if (mask) {
+        f(thread, i, mask);
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int thread = 1; thread < threads; ++thread) {
+      workers.emplace_back(run_part, thread);
+    }
+    run_part(0);
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  // Calls f(thread, row) for every matching row
+  template <typename F> void run(F f) const {
+    run_batches([&](unsigned int thread, std::size_t first,
+                    std::uint32_t mask) {
+      while (mask) {
+        f(thread, first + __builtin_ctz(mask));
+        mask &= mask - 1;
+      }
+    });
+  }
+
+  const person_table *m_table;
+  Predicate m_predicate;
+  Grouping m_grouping;
+  unsigned int m_threads;
+};
+
+inline query_t<> from(const person_table &table) { return query_t<>(table); }
+
+} // namespace query
+
+#endif // QUERY_H
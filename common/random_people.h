@@ -0,0 +1,48 @@
+#ifndef RANDOM_PEOPLE_H
+#define RANDOM_PEOPLE_H
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "person.h"
+
+// Generates a population for the examples that need more than
+// a handful of persons. Names and surnames are picked from short
+// lists, so they repeat a lot, like they do in real populations.
+// The same seed always generates the same persons.
+inline std::vector<person_t> random_people(std::size_t count,
+                                           unsigned int seed = 42)
+{
+    static const std::vector<std::string> names{
+        "David", "Jane",  "Martha", "Peter",   "Rose",   "Tom",
+        "Anna",  "John",  "Mary",   "Michael", "Sarah",  "James",
+        "Linda", "Paul",  "Emma",   "Robert",  "Olivia", "William",
+        "Sophia", "Henry", "Alexandria", "Maximilian", "Christopher",
+        "Elizabeth"};
+
+    static const std::vector<std::string> surnames{
+        "Doe",    "Smith",    "Johnson",  "Williams", "Brown",
+        "Jones",  "Garcia",   "Miller",   "Davis",    "Rodriguez",
+        "Martinez", "Hernandez", "Lopez", "Gonzalez", "Wilson",
+        "Anderson", "Thomas", "Taylor",   "Moore",    "Jackson",
+        "Wolfeschlegelsteinhausen", "Featherstonehaugh"};
+
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<std::size_t> name(0, names.size() - 1);
+    std::uniform_int_distribution<std::size_t> surname(0, surnames.size() - 1);
+    std::uniform_int_distribution<int> gender(0, 2);
+    std::uniform_int_distribution<int> age(0, 99);
+
+    std::vector<person_t> result;
+    result.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        result.emplace_back(names[name(random)], surnames[surname(random)],
+                            static_cast<person_t::gender_t>(gender(random)),
+                            age(random));
+    }
+    return result;
+}
+
+#endif // RANDOM_PEOPLE_H
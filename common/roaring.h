@@ -0,0 +1,522 @@
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+// A compressed bitmap of 32-bit integers, in the style of Roaring bitmaps.
+//
+// The integers are grouped by their upper 16 bits into chunks of 65536
+// possible values. Each chunk is stored in a container which is either
+//  - a sorted array of the lower 16 bits, when the chunk contains
+//    at most 4096 integers (8KB at most), or
+//  - a plain bitmap of 1024 64-bit words (always 8KB) when there are
+//    more of them.
+// Sparse sets take little memory, dense ones are processed a word
+// at a time with bitwise operations, and the number of items in the
+// result of an operation is counted with popcount.
+class roaring_bitmap {
+public:
+  roaring_bitmap() = default;
+
+  roaring_bitmap(std::initializer_list<std::uint32_t> values) {
+    for (auto value : values) {
+      add(value);
+    }
+  }
+
+  // A bitmap containing all the integers in [0, size)
+  static roaring_bitmap range(std::uint32_t size) {
+    roaring_bitmap result;
+    if (size == 0) {
+      return result;
+    }
+    const std::uint32_t last_key = (size - 1) >> 16;
+    for (std::uint32_t key = 0; key <= last_key; ++key) {
+      const auto end =
+          std::min<std::uint64_t>(size - (std::uint64_t(key) << 16), 1 << 16);
+      container_t container;
+      container.key = static_cast<std::uint16_t>(key);
+      if (end > array_max_size) {
+        container.bits.assign(bitmap_words, 0);
+        for (std::uint64_t i = 0; i < end / 64; ++i) {
+          container.bits[i] = ~std::uint64_t(0);
+        }
+        if (end % 64) {
+          container.bits[end / 64] = (std::uint64_t(1) << (end % 64)) - 1;
+        }
+      } else {
+        for (std::uint64_t i = 0; i < end; ++i) {
+          container.array.push_back(static_cast<std::uint16_t>(i));
+        }
+      }
+      container.cardinality = static_cast<std::uint32_t>(end);
+      result.m_containers.push_back(std::move(container));
+    }
+    return result;
+  }
+
+  void add(std::uint32_t value) {
+    find_or_create(high(value)).add(low(value));
+  }
+
+  void remove(std::uint32_t value) {
+    auto it = find(high(value));
+    if (it != m_containers.end() && it->key == high(value)) {
+      it->remove(low(value));
+      if (it->cardinality == 0) {
+        m_containers.erase(it);
+      }
+    }
+  }
+
+  bool contains(std::uint32_t value) const {
+    auto it = find(high(value));
+    return it != m_containers.end() && it->key == high(value) &&
+           it->contains(low(value));
+  }
+
+  std::size_t cardinality() const {
+    std::size_t result = 0;
+    for (const auto &container : m_containers) {
+      result += container.cardinality;
+    }
+    return result;
+  }
+
+  bool empty() const { return m_containers.empty(); }
+
+  // Calls the function for every integer in the bitmap, in order
+  template <typename F> void for_each(F f) const {
+    for (const auto &container : m_containers) {
+      const std::uint32_t base = std::uint32_t(container.key) << 16;
+      container.for_each([&](std::uint16_t value) { f(base | value); });
+    }
+  }
+
+  std::vector<std::uint32_t> to_vector() const {
+    std::vector<std::uint32_t> result;
+    result.reserve(cardinality());
+    for_each([&result](std::uint32_t value) { result.push_back(value); });
+    return result;
+  }
+
+  friend roaring_bitmap operator&(const roaring_bitmap &left,
+                                  const roaring_bitmap &right) {
+    roaring_bitmap result;
+    auto l = left.m_containers.begin();
+    auto r = right.m_containers.begin();
+    while (l != left.m_containers.end() && r != right.m_containers.end()) {
+      if (l->key < r->key) {
+        ++l;
+      } else if (r->key < l->key) {
+        ++r;
+      } else {
+        auto container = container_t::intersect(*l++, *r++);
+        if (container.cardinality != 0) {
+          result.m_containers.push_back(std::move(container));
+        }
+      }
+    }
+    return result;
+  }
+
+  friend roaring_bitmap operator|(const roaring_bitmap &left,
+                                  const roaring_bitmap &right) {
+    roaring_bitmap result;
+    auto l = left.m_containers.begin();
+    auto r = right.m_containers.begin();
+    while (l != left.m_containers.end() || r != right.m_containers.end()) {
+      if (r == right.m_containers.end() ||
+          (l != left.m_containers.end() && l->key < r->key)) {
+        result.m_containers.push_back(*l++);
+      } else if (l == left.m_containers.end() || r->key < l->key) {
+        result.m_containers.push_back(*r++);
+      } else {
+        result.m_containers.push_back(container_t::unite(*l++, *r++));
+      }
+    }
+    return result;
+  }
+
+  // Difference -- the integers from the left bitmap
+  // that are not in the right one
+  friend roaring_bitmap operator-(const roaring_bitmap &left,
+                                  const roaring_bitmap &right) {
+    roaring_bitmap result;
+    auto r = right.m_containers.begin();
+    for (const auto &container : left.m_containers) {
+      while (r != right.m_containers.end() && r->key < container.key) {
+        ++r;
+      }
+      if (r != right.m_containers.end() && r->key == container.key) {
+        auto difference = container_t::subtract(container, *r);
+        if (difference.cardinality != 0) {
+          result.m_containers.push_back(std::move(difference));
+        }
+      } else {
+        result.m_containers.push_back(container);
+      }
+    }
+    return result;
+  }
+
+  roaring_bitmap &operator&=(const roaring_bitmap &other) {
+    return *this = *this & other;
+  }
+
+  roaring_bitmap &operator|=(const roaring_bitmap &other) {
+    return *this = *this | other;
+  }
+
+  roaring_bitmap &operator-=(const roaring_bitmap &other) {
+    return *this = *this - other;
+  }
+
+  // The union of all the bitmaps in [first, last). Uniting them one
+  // by one with |= copies the growing result for every bitmap, here
+  // the containers with the same key are ORed into a single bitmap
+  // container, which becomes an array again if it is small enough.
+  template <typename It> static roaring_bitmap unite_all(It first, It last) {
+    std::vector<const container_t *> containers;
+    for (; first != last; ++first) {
+      for (const auto &container : first->m_containers) {
+        containers.push_back(&container);
+      }
+    }
+    std::sort(containers.begin(), containers.end(),
+              [](const container_t *left, const container_t *right) {
+                return left->key < right->key;
+              });
+
+    roaring_bitmap result;
+    auto group = containers.begin();
+    while (group != containers.end()) {
+      const auto key = (*group)->key;
+      const auto group_end =
+          std::find_if(group, containers.end(), [key](const container_t *c) {
+            return c->key != key;
+          });
+
+      if (group_end - group == 1) {
+        result.m_containers.push_back(**group);
+      } else {
+        container_t united;
+        united.key = key;
+        united.bits.assign(bitmap_words, 0);
+        for (; group != group_end; ++group) {
+          const auto &container = **group;
+          if (container.is_bitmap()) {
+            for (std::size_t i = 0; i < bitmap_words; ++i) {
+              united.bits[i] |= container.bits[i];
+            }
+          } else {
+            for (auto value : container.array) {
+              united.bits[value / 64] |= std::uint64_t(1) << (value % 64);
+            }
+          }
+        }
+        united.normalize();
+        result.m_containers.push_back(std::move(united));
+      }
+      group = group_end;
+    }
+    return result;
+  }
+
+  // The number of integers in both bitmaps, without creating
+  // the intersection
+  static std::size_t and_cardinality(const roaring_bitmap &left,
+                                     const roaring_bitmap &right) {
+    std::size_t result = 0;
+    auto l = left.m_containers.begin();
+    auto r = right.m_containers.begin();
+    while (l != left.m_containers.end() && r != right.m_containers.end()) {
+      if (l->key < r->key) {
+        ++l;
+      } else if (r->key < l->key) {
+        ++r;
+      } else {
+        result += container_t::intersect_cardinality(*l++, *r++);
+      }
+    }
+    return result;
+  }
+
+  static std::size_t or_cardinality(const roaring_bitmap &left,
+                                    const roaring_bitmap &right) {
+    return left.cardinality() + right.cardinality() -
+           and_cardinality(left, right);
+  }
+
+  static std::size_t andnot_cardinality(const roaring_bitmap &left,
+                                        const roaring_bitmap &right) {
+    return left.cardinality() - and_cardinality(left, right);
+  }
+
+  friend bool operator==(const roaring_bitmap &left,
+                         const roaring_bitmap &right) {
+    return left.cardinality() == right.cardinality() &&
+           and_cardinality(left, right) == left.cardinality();
+  }
+
+  friend bool operator!=(const roaring_bitmap &left,
+                         const roaring_bitmap &right) {
+    return !(left == right);
+  }
+
+private:
+  static constexpr std::uint32_t array_max_size = 4096;
+  static constexpr std::size_t bitmap_words = 1024;
+
+  static std::uint16_t high(std::uint32_t value) {
+    return static_cast<std::uint16_t>(value >> 16);
+  }
+
+  static std::uint16_t low(std::uint32_t value) {
+    return static_cast<std::uint16_t>(value & 0xFFFF);
+  }
+
+  struct container_t {
+    std::uint16_t key = 0;
+    std::uint32_t cardinality = 0;
+    std::vector<std::uint16_t> array; // used while not a bitmap
+    std::vector<std::uint64_t> bits;  // bitmap_words words, or empty
+
+    bool is_bitmap() const { return !bits.empty(); }
+
+    bool contains(std::uint16_t value) const {
+      if (is_bitmap()) {
+        return bits[value / 64] >> (value % 64) & 1;
+      }
+      return std::binary_search(array.begin(), array.end(), value);
+    }
+
+    void add(std::uint16_t value) {
+      if (is_bitmap()) {
+        auto &word = bits[value / 64];
+        const auto bit = std::uint64_t(1) << (value % 64);
+        cardinality += (word & bit) == 0;
+        word |= bit;
+        return;
+      }
+      auto it = std::lower_bound(array.begin(), array.end(), value);
+      if (it != array.end() && *it == value) {
+        return;
+      }
+      array.insert(it, value);
+      ++cardinality;
+      if (cardinality > array_max_size) {
+        to_bitmap();
+      }
+    }
+
+    void remove(std::uint16_t value) {
+      if (is_bitmap()) {
+        auto &word = bits[value / 64];
+        const auto bit = std::uint64_t(1) << (value % 64);
+        cardinality -= (word & bit) != 0;
+        word &= ~bit;
+        if (cardinality <= array_max_size) {
+          to_array();
+        }
+        return;
+      }
+      auto it = std::lower_bound(array.begin(), array.end(), value);
+      if (it != array.end() && *it == value) {
+        array.erase(it);
+        --cardinality;
+      }
+    }
+
+    template <typename F> void for_each(F f) const {
+      if (is_bitmap()) {
+        for (std::size_t i = 0; i < bitmap_words; ++i) {
+          auto word = bits[i];
+          while (word) {
+            f(static_cast<std::uint16_t>(i * 64 + __builtin_ctzll(word)));
+            word &= word - 1;
+          }
+        }
+      } else {
+        std::for_each(array.begin(), array.end(), f);
+      }
+    }
+
+    void to_bitmap() {
+      bits.assign(bitmap_words, 0);
+      for (auto value : array) {
+        bits[value / 64] |= std::uint64_t(1) << (value % 64);
+      }
+      array.clear();
+      array.shrink_to_fit();
+    }
+
+    void to_array() {
+      std::vector<std::uint16_t> values;
+      values.reserve(cardinality);
+      for_each([&values](std::uint16_t value) { values.push_back(value); });
+      bits.clear();
+      bits.shrink_to_fit();
+      array = std::move(values);
+    }
+
+    // Recounts the bits and picks the smaller representation
+    void normalize() {
+      if (is_bitmap()) {
+        cardinality = 0;
+        for (auto word : bits) {
+          cardinality += __builtin_popcountll(word);
+        }
+        if (cardinality <= array_max_size) {
+          to_array();
+        }
+      } else {
+        cardinality = static_cast<std::uint32_t>(array.size());
+        if (cardinality > array_max_size) {
+          to_bitmap();
+        }
+      }
+    }
+
+    static container_t intersect(const container_t &left,
+                                 const container_t &right) {
+      container_t result;
+      result.key = left.key;
+      if (left.is_bitmap() && right.is_bitmap()) {
+        result.bits.resize(bitmap_words);
+        for (std::size_t i = 0; i < bitmap_words; ++i) {
+          result.bits[i] = left.bits[i] & right.bits[i];
+        }
+      } else if (left.is_bitmap() || right.is_bitmap()) {
+        const auto &array = left.is_bitmap() ? right : left;
+        const auto &bitmap = left.is_bitmap() ? left : right;
+        for (auto value : array.array) {
+          if (bitmap.contains(value)) {
+            result.array.push_back(value);
+          }
+        }
+      } else {
+        std::set_intersection(left.array.begin(), left.array.end(),
+                              right.array.begin(), right.array.end(),
+                              std::back_inserter(result.array));
+      }
+      result.normalize();
+      return result;
+    }
+
+    static container_t unite(const container_t &left,
+                             const container_t &right) {
+      container_t result;
+      result.key = left.key;
+      if (left.is_bitmap() || right.is_bitmap()) {
+        result.bits = left.is_bitmap() ? left.bits : right.bits;
+        const auto &other = left.is_bitmap() ? right : left;
+        if (other.is_bitmap()) {
+          for (std::size_t i = 0; i < bitmap_words; ++i) {
+            result.bits[i] |= other.bits[i];
+          }
+        } else {
+          for (auto value : other.array) {
+            result.bits[value / 64] |= std::uint64_t(1) << (value % 64);
+          }
+        }
+      } else {
+        std::set_union(left.array.begin(), left.array.end(),
+                       right.array.begin(), right.array.end(),
+                       std::back_inserter(result.array));
+      }
+      result.normalize();
+      return result;
+    }
+
+    static container_t subtract(const container_t &left,
+                                const container_t &right) {
+      container_t result;
+      result.key = left.key;
+      if (left.is_bitmap()) {
+        result.bits = left.bits;
+        if (right.is_bitmap()) {
+          for (std::size_t i = 0; i < bitmap_words; ++i) {
+            result.bits[i] &= ~right.bits[i];
+          }
+        } else {
+          for (auto value : right.array) {
+            result.bits[value / 64] &= ~(std::uint64_t(1) << (value % 64));
+          }
+        }
+      } else {
+        for (auto value : left.array) {
+          if (!right.contains(value)) {
+            result.array.push_back(value);
+          }
+        }
+      }
+      result.normalize();
+      return result;
+    }
+
+    static std::uint32_t intersect_cardinality(const container_t &left,
+                                               const container_t &right) {
+      std::uint32_t result = 0;
+      if (left.is_bitmap() && right.is_bitmap()) {
+        for (std::size_t i = 0; i < bitmap_words; ++i) {
+          result += __builtin_popcountll(left.bits[i] & right.bits[i]);
+        }
+      } else if (left.is_bitmap() || right.is_bitmap()) {
+        const auto &array = left.is_bitmap() ? right : left;
+        const auto &bitmap = left.is_bitmap() ? left : right;
+        for (auto value : array.array) {
+          result += bitmap.contains(value);
+        }
+      } else {
+        auto l = left.array.begin();
+        auto r = right.array.begin();
+        while (l != left.array.end() && r != right.array.end()) {
+          if (*l < *r) {
+            ++l;
+          } else if (*r < *l) {
+            ++r;
+          } else {
+            ++result;
+            ++l;
+            ++r;
+          }
+        }
+      }
+      return result;
+    }
+  };
+
+  static bool key_less(const container_t &container, std::uint16_t key) {
+    return container.key < key;
+  }
+
+  std::vector<container_t>::const_iterator find(std::uint16_t key) const {
+    return std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                            key_less);
+  }
+
+  std::vector<container_t>::iterator find(std::uint16_t key) {
+    return std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                            key_less);
+  }
+
+  container_t &find_or_create(std::uint16_t key) {
+    auto it = find(key);
+    if (it == m_containers.end() || it->key != key) {
+      it = m_containers.insert(it, container_t());
+      it->key = key;
+    }
+    return *it;
+  }
+
+  // Sorted by the key
+  std::vector<container_t> m_containers;
+};
+
+#endif // ROARING_H
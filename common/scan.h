@@ -0,0 +1,316 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Scans (prefix sums) over an associative operation.
+//
+// Where a fold like std::accumulate returns only the final result,
+// a scan returns all the intermediate ones: scanning {1, 2, 3, 4}
+// with addition gives the running totals {1, 3, 6, 10} (inclusive scan)
+// or {0, 1, 3, 6} (exclusive scan).
+//
+// The operation is given as a monoid -- an associative binary operation
+// together with its identity element. Associativity is what allows the
+// parallel version to scan the blocks of the collection independently,
+// and the identity is the first item of an exclusive scan.
+//
+// Every algorithm comes in three variants, chosen by the first argument:
+//  - scan::seq -- a plain left-to-right loop,
+//  - scan::simd -- scans four ints at a time with SSE2 when the monoid
+//    is the addition of ints in a contiguous collection, falls back
+//    to the sequential loop otherwise,
+//  - scan::par -- the two-pass block algorithm: the collection is split
+//    into a block per thread, every block is reduced in parallel, the
+//    block results are scanned to get the starting value of each block,
+//    and then the blocks are scanned in parallel.
+namespace scan {
+
+template <typename T, typename Op> struct monoid_t {
+  T identity;
+  Op op;
+};
+
+template <typename T, typename Op> auto monoid(T identity, Op op) {
+  return monoid_t<T, Op>{std::move(identity), std::move(op)};
+}
+
+template <typename T> auto sum() { return monoid(T(0), std::plus<T>()); }
+
+template <typename T> auto product() {
+  return monoid(T(1), std::multiplies<T>());
+}
+
+template <typename T> auto maximum() {
+  return monoid(std::numeric_limits<T>::lowest(),
+                [](const T &lhs, const T &rhs) { return std::max(lhs, rhs); });
+}
+
+struct sequential_policy {};
+
+struct simd_policy {};
+
+struct parallel_policy {
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // Blocks smaller than this are not worth a thread
+  std::size_t min_block_size = 1 << 14;
+};
+
+constexpr sequential_policy seq{};
+constexpr simd_policy simd{};
+const parallel_policy par{};
+
+namespace detail {
+
+// Scans a range, starting from the given value.
+// When `inclusive` is false, every item gets the value accumulated
+// before it. Returns the value accumulated over the whole range,
+// so that the blocks can be chained.
+template <bool inclusive, typename InIt, typename OutIt, typename T,
+          typename Op>
+auto scan_block(InIt first, InIt last, OutIt out, T acc, Op &op)
+    -> std::pair<OutIt, T> {
+  for (; first != last; ++first, ++out) {
+    if constexpr (inclusive) {
+      acc = op(std::move(acc), *first);
+      *out = acc;
+    } else {
+      auto next = op(acc, *first);
+      *out = std::move(acc);
+      acc = std::move(next);
+    }
+  }
+  return {out, std::move(acc)};
+}
+
+template <typename It>
+constexpr bool is_contiguous_int_output_v =
+    std::is_same_v<It, int *> || std::is_same_v<It, std::vector<int>::iterator>;
+
+template <typename It>
+constexpr bool is_contiguous_int_input_v =
+    is_contiguous_int_output_v<It> || std::is_same_v<It, const int *> ||
+    std::is_same_v<It, std::vector<int>::const_iterator>;
+
+template <typename Op>
+constexpr bool is_int_addition_v = std::is_same_v<Op, std::plus<int>> ||
+                                   std::is_same_v<Op, std::plus<>>;
+
+#ifdef __SSE2__
+// Scans four ints at a time. Within a register, the prefix sum is
+// computed in two steps by adding the register shifted by one and
+// then by two items to itself. The total of the previous four items
+// is broadcast to all lanes and added as the carry.
+template <bool inclusive>
+auto scan_ints_sse2(const int *first, const int *last, int *out, int acc)
+    -> int {
+  auto carry = _mm_set1_epi32(acc);
+  for (; last - first >= 4; first += 4, out += 4) {
+    auto x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+    auto sums = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 8));
+    sums = _mm_add_epi32(sums, carry);
+    if constexpr (inclusive) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out), sums);
+    } else {
+      // Exclusive scan is the inclusive one shifted by one item
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                       _mm_sub_epi32(sums, x));
+    }
+    carry = _mm_shuffle_epi32(sums, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  acc = _mm_cvtsi128_si32(carry);
+
+  std::plus<int> op;
+  return scan_block<inclusive>(first, last, out, acc, op).second;
+}
+#endif
+
+template <bool inclusive, typename InIt, typename OutIt, typename T,
+          typename Op>
+auto scan_simd(InIt first, InIt last, OutIt out, T acc, Op &op)
+    -> std::pair<OutIt, T> {
+#ifdef __SSE2__
+  if constexpr (std::is_same_v<T, int> && is_int_addition_v<Op> &&
+                is_contiguous_int_input_v<InIt> &&
+                is_contiguous_int_output_v<OutIt>) {
+    const auto size = std::distance(first, last);
+    if (size == 0) {
+      return {out, acc};
+    }
+    acc = scan_ints_sse2<inclusive>(&*first, &*first + size, &*out, acc);
+    return {std::next(out, size), acc};
+  }
+#endif
+  return scan_block<inclusive>(first, last, out, std::move(acc), op);
+}
+
+template <bool inclusive, typename InIt, typename OutIt, typename T,
+          typename Op>
+auto scan(const sequential_policy &, InIt first, InIt last, OutIt out,
+          const monoid_t<T, Op> &monoid) -> OutIt {
+  auto op = monoid.op;
+  return scan_block<inclusive>(first, last, out, monoid.identity, op).first;
+}
+
+template <bool inclusive, typename InIt, typename OutIt, typename T,
+          typename Op>
+auto scan(const simd_policy &, InIt first, InIt last, OutIt out,
+          const monoid_t<T, Op> &monoid) -> OutIt {
+  auto op = monoid.op;
+  return scan_simd<inclusive>(first, last, out, monoid.identity, op).first;
+}
+
+template <bool inclusive, typename InIt, typename OutIt, typename T,
+          typename Op>
+auto scan(const parallel_policy &policy, InIt first, InIt last, OutIt out,
+          const monoid_t<T, Op> &monoid) -> OutIt {
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  const auto blocks = std::max<std::size_t>(
+      1, std::min<std::size_t>(policy.threads, size / policy.min_block_size));
+
+  if (blocks == 1) {
+    return scan<inclusive>(simd, first, last, out, monoid);
+  }
+
+  const auto block_size = size / blocks;
+  auto block_begin = [&](std::size_t block) {
+    return std::next(first, block * block_size);
+  };
+  auto block_end = [&](std::size_t block) {
+    return block + 1 == blocks ? last
+                               : std::next(first, (block + 1) * block_size);
+  };
+
+  // Runs the function for every block, the last one
+  // on the current thread
+  auto for_each_block = [blocks](auto f) {
+    std::vector<std::thread> workers;
+    workers.reserve(blocks - 1);
+    for (std::size_t block = 0; block + 1 < blocks; ++block) {
+      workers.emplace_back(f, block);
+    }
+    f(blocks - 1);
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  };
+
+  // First pass: reducing every block. The last block
+  // does not need to be reduced, nothing comes after it.
+  std::vector<T> offsets(blocks, monoid.identity);
+  for_each_block([&](std::size_t block) {
+    if (block + 1 < blocks) {
+      auto op = monoid.op;
+      offsets[block + 1] =
+          std::accumulate(block_begin(block), block_end(block),
+                          monoid.identity, op);
+    }
+  });
+
+  // The starting value of every block is the exclusive scan
+  // of the block results, which is inclusive after the shift above
+  for (std::size_t block = 1; block < blocks; ++block) {
+    offsets[block] = monoid.op(offsets[block - 1], offsets[block]);
+  }
+
+  // Second pass: scanning every block from its starting value
+  for_each_block([&](std::size_t block) {
+    auto op = monoid.op;
+    scan_simd<inclusive>(block_begin(block), block_end(block),
+                         std::next(out, block * block_size), offsets[block],
+                         op);
+  });
+
+  return std::next(out, size);
+}
+
+} // namespace detail
+
+// Inclusive scan: the n-th output item is the result
+// of combining the first n+1 input items. O(n)
+template <typename Policy, typename InIt, typename OutIt, typename T,
+          typename Op>
+auto inclusive(const Policy &policy, InIt first, InIt last, OutIt out,
+               const monoid_t<T, Op> &monoid) -> OutIt {
+  return detail::scan<true>(policy, first, last, out, monoid);
+}
+
+// Exclusive scan: the n-th output item is the result of combining
+// the first n input items, the first one is the identity. O(n)
+template <typename Policy, typename InIt, typename OutIt, typename T,
+          typename Op>
+auto exclusive(const Policy &policy, InIt first, InIt last, OutIt out,
+               const monoid_t<T, Op> &monoid) -> OutIt {
+  return detail::scan<false>(policy, first, last, out, monoid);
+}
+
+// Stream compaction -- copies the items that satisfy the predicate,
+// keeping their order, like std::copy_if does. The exclusive scan
+// of the predicate results gives every selected item its position
+// in the output, so the items can be copied independently of each
+// other, in parallel when using scan::par. Unlike std::copy_if,
+// the output iterator needs to be a random access one. O(n)
+template <typename Policy, typename InIt, typename OutIt, typename P>
+auto copy_if(const Policy &policy, InIt first, InIt last, OutIt out,
+             P predicate) -> OutIt {
+  const auto size = static_cast<std::size_t>(std::distance(first, last));
+  if (size == 0) {
+    return out;
+  }
+
+  std::vector<int> selected(size);
+  std::transform(first, last, selected.begin(), [&predicate](const auto &item) {
+    return predicate(item) ? 1 : 0;
+  });
+
+  std::vector<int> positions(size);
+  exclusive(policy, selected.cbegin(), selected.cend(), positions.begin(),
+            sum<int>());
+
+  auto scatter = [&](std::size_t begin, std::size_t end) {
+    auto item = std::next(first, begin);
+    for (auto i = begin; i < end; ++i, ++item) {
+      if (selected[i]) {
+        *std::next(out, positions[i]) = *item;
+      }
+    }
+  };
+
+  if constexpr (std::is_same_v<Policy, parallel_policy>) {
+    const auto blocks = std::max<std::size_t>(
+        1, std::min<std::size_t>(policy.threads, size / policy.min_block_size));
+    const auto block_size = size / blocks;
+    std::vector<std::thread> workers;
+    for (std::size_t block = 0; block + 1 < blocks; ++block) {
+      workers.emplace_back(scatter, block * block_size,
+                           (block + 1) * block_size);
+    }
+    scatter((blocks - 1) * block_size, size);
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  } else {
+    scatter(0, size);
+  }
+
+  return std::next(out, positions.back() + selected.back());
+}
+
+} // namespace scan
+
+#endif // SCAN_H
@@ -0,0 +1,248 @@
+#ifndef TRACKED_H
+#define TRACKED_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+// Instrumentation for counting how many times values get constructed,
+// copied, moved and destroyed, and how much memory they allocate.
+//
+// Instead of printing on every call like accumulate_test from 2.16,
+// the events are counted with atomic counters, so the counting works
+// when the values are used from several threads, and the results can
+// be checked by the program itself:
+//
+//     tracked<std::string>::reset();
+//     ...
+//     if (tracked<std::string>::report().copies() != 0) throw;
+//
+// The counters are shared by all tracked values with the same tag.
+// The tag defaults to the wrapped type, a different one can be used
+// to count separately values of the same type used in different places.
+
+// A snapshot of the counters
+struct tracking_report {
+  std::size_t default_constructions = 0;
+  std::size_t value_constructions = 0;
+  std::size_t copy_constructions = 0;
+  std::size_t move_constructions = 0;
+  std::size_t copy_assignments = 0;
+  std::size_t move_assignments = 0;
+  std::size_t destructions = 0;
+  std::size_t allocations = 0;
+  std::size_t deallocations = 0;
+  std::size_t bytes_allocated = 0;
+
+  std::size_t copies() const { return copy_constructions + copy_assignments; }
+
+  std::size_t moves() const { return move_constructions + move_assignments; }
+
+  std::size_t constructions() const {
+    return default_constructions + value_constructions + copy_constructions +
+           move_constructions;
+  }
+
+  // Values that were constructed, but not yet destroyed
+  std::size_t alive() const { return constructions() - destructions; }
+};
+
+inline std::ostream &operator<<(std::ostream &out,
+                                const tracking_report &report) {
+  return out << "constructions: " << report.constructions()
+             << " (default: " << report.default_constructions
+             << ", value: " << report.value_constructions
+             << ", copy: " << report.copy_constructions
+             << ", move: " << report.move_constructions << ")\n"
+             << "assignments:   copy: " << report.copy_assignments
+             << ", move: " << report.move_assignments << '\n'
+             << "destructions:  " << report.destructions << '\n'
+             << "allocations:   " << report.allocations << " ("
+             << report.bytes_allocated << " bytes), deallocations: "
+             << report.deallocations << '\n';
+}
+
+namespace detail {
+
+struct tracking_counters {
+  std::atomic<std::size_t> default_constructions{0};
+  std::atomic<std::size_t> value_constructions{0};
+  std::atomic<std::size_t> copy_constructions{0};
+  std::atomic<std::size_t> move_constructions{0};
+  std::atomic<std::size_t> copy_assignments{0};
+  std::atomic<std::size_t> move_assignments{0};
+  std::atomic<std::size_t> destructions{0};
+  std::atomic<std::size_t> allocations{0};
+  std::atomic<std::size_t> deallocations{0};
+  std::atomic<std::size_t> bytes_allocated{0};
+
+  // Only the counts matter, not the order in which
+  // different threads incremented them
+  static void increment(std::atomic<std::size_t> &counter,
+                        std::size_t value = 1) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  tracking_report report() const {
+    tracking_report result;
+    result.default_constructions = default_constructions.load();
+    result.value_constructions = value_constructions.load();
+    result.copy_constructions = copy_constructions.load();
+    result.move_constructions = move_constructions.load();
+    result.copy_assignments = copy_assignments.load();
+    result.move_assignments = move_assignments.load();
+    result.destructions = destructions.load();
+    result.allocations = allocations.load();
+    result.deallocations = deallocations.load();
+    result.bytes_allocated = bytes_allocated.load();
+    return result;
+  }
+
+  void reset() {
+    default_constructions = 0;
+    value_constructions = 0;
+    copy_constructions = 0;
+    move_constructions = 0;
+    copy_assignments = 0;
+    move_assignments = 0;
+    destructions = 0;
+    allocations = 0;
+    deallocations = 0;
+    bytes_allocated = 0;
+  }
+};
+
+template <typename Tag> tracking_counters &counters_for() {
+  static tracking_counters counters;
+  return counters;
+}
+
+} // namespace detail
+
+// Wraps a value of type T and counts the special member function
+// calls. The wrapped value is accessed through value(), * or ->
+template <typename T, typename Tag = T> class tracked {
+public:
+  tracked() : m_value() {
+    counters().increment(counters().default_constructions);
+  }
+
+  // Constructs the wrapped value from the arguments
+  template <typename Arg, typename... Args,
+            typename = std::enable_if_t<
+                sizeof...(Args) != 0 ||
+                !std::is_same_v<std::decay_t<Arg>, tracked>>>
+  tracked(Arg &&arg, Args &&... args)
+      : m_value(std::forward<Arg>(arg), std::forward<Args>(args)...) {
+    counters().increment(counters().value_constructions);
+  }
+
+  tracked(const tracked &other) : m_value(other.m_value) {
+    counters().increment(counters().copy_constructions);
+  }
+
+  tracked(tracked &&other) noexcept(
+      std::is_nothrow_move_constructible_v<T>)
+      : m_value(std::move(other.m_value)) {
+    counters().increment(counters().move_constructions);
+  }
+
+  tracked &operator=(const tracked &other) {
+    counters().increment(counters().copy_assignments);
+    m_value = other.m_value;
+    return *this;
+  }
+
+  tracked &operator=(tracked &&other) noexcept(
+      std::is_nothrow_move_assignable_v<T>) {
+    counters().increment(counters().move_assignments);
+    m_value = std::move(other.m_value);
+    return *this;
+  }
+
+  ~tracked() { counters().increment(counters().destructions); }
+
+  T &value() & { return m_value; }
+  const T &value() const & { return m_value; }
+  T &&value() && { return std::move(m_value); }
+
+  T &operator*() & { return m_value; }
+  const T &operator*() const & { return m_value; }
+
+  T *operator->() { return &m_value; }
+  const T *operator->() const { return &m_value; }
+
+  friend bool operator==(const tracked &left, const tracked &right) {
+    return left.m_value == right.m_value;
+  }
+
+  friend bool operator!=(const tracked &left, const tracked &right) {
+    return !(left == right);
+  }
+
+  friend bool operator<(const tracked &left, const tracked &right) {
+    return left.m_value < right.m_value;
+  }
+
+  static tracking_report report() { return counters().report(); }
+
+  static void reset() { counters().reset(); }
+
+private:
+  static detail::tracking_counters &counters() {
+    return detail::counters_for<Tag>();
+  }
+
+  T m_value;
+};
+
+// An allocator which counts the allocations and the allocated bytes.
+// Counts into the same counters as tracked<..., Tag>, so the memory
+// that a tracked container allocates shows up in its report:
+//
+//     using strings = std::vector<std::string,
+//                                 tracking_allocator<std::string, tag>>;
+//     tracked<strings, tag> value;
+template <typename T, typename Tag = T> class tracking_allocator {
+public:
+  using value_type = T;
+
+  template <typename U> struct rebind {
+    using other = tracking_allocator<U, Tag>;
+  };
+
+  tracking_allocator() = default;
+
+  template <typename U>
+  tracking_allocator(const tracking_allocator<U, Tag> &) noexcept {}
+
+  T *allocate(std::size_t count) {
+    auto &counters = detail::counters_for<Tag>();
+    counters.increment(counters.allocations);
+    counters.increment(counters.bytes_allocated, count * sizeof(T));
+    return static_cast<T *>(::operator new(count * sizeof(T)));
+  }
+
+  void deallocate(T *pointer, std::size_t) noexcept {
+    auto &counters = detail::counters_for<Tag>();
+    counters.increment(counters.deallocations);
+    ::operator delete(pointer);
+  }
+
+  template <typename U>
+  friend bool operator==(const tracking_allocator &,
+                         const tracking_allocator<U, Tag> &) {
+    return true;
+  }
+
+  template <typename U>
+  friend bool operator!=(const tracking_allocator &,
+                         const tracking_allocator<U, Tag> &) {
+    return false;
+  }
+};
+
+#endif // TRACKED_H
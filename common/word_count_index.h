@@ -0,0 +1,758 @@
+#ifndef WORD_COUNT_INDEX_H
+#define WORD_COUNT_INDEX_H
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "histogram.h"
+
+// An on-disk index of word counts, for corpora with more distinct
+// words than fit into memory. New documents are added to the index
+// without recounting the words of the documents added before.
+//
+// The index is a log-structured merge tree:
+//  - the words are counted in memory, in a string_histogram. When it
+//    has too many distinct words, when the count of a word would not
+//    fit into its 32 bits, or when the words would not fit into its
+//    arena, they are sorted and written to a new run -- an immutable
+//    file with (word, count) records sorted by the word, where the
+//    counts have 64 bits,
+//  - a background thread merges neighbouring runs into bigger ones,
+//    adding up the counts of the words they have in common, so that
+//    the number of runs grows only logarithmically with the corpus,
+//  - queries merge the runs and the words in memory on the fly.
+//    Since every run is sorted, finding the most frequent words
+//    reads every run once, sequentially, and the merged stream goes
+//    through a top_k_heap.
+//
+// Runs are named after the range of flushes they contain. A run that
+// contains a single flush is of tier 0, merging merge_factor runs of
+// tier n gives a run of tier n + 1. A merged run appears under its
+// name only when it is complete, and the runs it replaces are removed
+// afterwards -- if the process stops in between, the runs contained in
+// another run are removed when the index is opened again.
+//
+// The run files are memory mapped. Every run has a sparse index with
+// the position of every 64th record, so looking a word up is a binary
+// search in the index followed by a scan of at most 64 records.
+//
+// Like the standard containers, an index can be used by one thread
+// at a time. The background merges do not need to be synchronized
+// with, but the words added after the last flush are only in memory:
+// they are written when the index is destroyed, or by flush().
+
+// The footer at the end of a run file, after the records and the index
+struct word_run_footer {
+  std::uint64_t record_count;
+  std::uint64_t index_offset;
+  std::uint64_t index_count;
+  std::uint32_t byte_order;
+  std::uint32_t version;
+  char magic[8];
+};
+
+static_assert(sizeof(word_run_footer) == 40, "unexpected footer padding");
+
+namespace word_run_format {
+constexpr char magic[8] = {'F', 'P', 'C', 'P', 'W', 'R', 'U', 'N'};
+constexpr std::uint32_t byte_order = 0x01020304;
+constexpr std::uint32_t version = 1;
+
+// Every record starts with the length of the word and the count,
+// followed by the characters of the word
+constexpr std::size_t record_header_size =
+    sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+// The index has the position of every index_interval-th record
+constexpr std::uint64_t index_interval = 64;
+
+inline void append_record(std::string &out, std::string_view word,
+                          std::uint64_t count) {
+  if (word.size() > UINT32_MAX) {
+    throw std::length_error("word too long");
+  }
+  const auto length = static_cast<std::uint32_t>(word.size());
+  out.append(reinterpret_cast<const char *>(&length), sizeof(length));
+  out.append(reinterpret_cast<const char *>(&count), sizeof(count));
+  out.append(word);
+}
+} // namespace word_run_format
+
+// Reads consecutive records, of a run file or of a buffer
+// filled by word_run_format::append_record
+class word_run_cursor {
+public:
+  word_run_cursor(const char *first, const char *last)
+      : m_position(first), m_last(last) {
+    read();
+  }
+
+  bool done() const { return m_position == m_last; }
+
+  // The word points into the run, it stays valid after next()
+  std::string_view word() const { return m_word; }
+  std::uint64_t count() const { return m_count; }
+
+  void next() {
+    m_position += word_run_format::record_header_size + m_word.size();
+    read();
+  }
+
+private:
+  void read() {
+    if (done()) {
+      return;
+    }
+
+    std::uint32_t length;
+    if (std::size_t(m_last - m_position) <
+        word_run_format::record_header_size) {
+      throw std::runtime_error("truncated word run record");
+    }
+    std::memcpy(&length, m_position, sizeof(length));
+    std::memcpy(&m_count, m_position + sizeof(length), sizeof(m_count));
+
+    const auto word = m_position + word_run_format::record_header_size;
+    if (std::size_t(m_last - word) < length) {
+      throw std::runtime_error("truncated word run record");
+    }
+    m_word = std::string_view(word, length);
+  }
+
+  const char *m_position;
+  const char *m_last;
+  std::string_view m_word;
+  std::uint64_t m_count = 0;
+};
+
+// Calls f(word, count) for every word of the sorted record streams,
+// in order, with the counts of the word in all of them added up
+template <typename F>
+void merge_word_runs(std::vector<word_run_cursor> cursors, F f) {
+  auto after = [&cursors](std::size_t left, std::size_t right) {
+    return cursors[left].word() > cursors[right].word();
+  };
+  std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(after)>
+      queue(after);
+  for (std::size_t i = 0; i < cursors.size(); ++i) {
+    if (!cursors[i].done()) {
+      queue.push(i);
+    }
+  }
+
+  while (!queue.empty()) {
+    const auto word = cursors[queue.top()].word();
+    std::uint64_t count = 0;
+    while (!queue.empty() && cursors[queue.top()].word() == word) {
+      auto &cursor = cursors[queue.top()];
+      const auto i = queue.top();
+      queue.pop();
+      count += cursor.count();
+      cursor.next();
+      if (!cursor.done()) {
+        queue.push(i);
+      }
+    }
+    f(word, count);
+  }
+}
+
+// A read-only memory mapped run
+class word_run {
+public:
+  explicit word_run(const std::string &path) : m_path(path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "can not open " + path);
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(),
+                              "can not stat " + path);
+    }
+    m_size = static_cast<std::size_t>(status.st_size);
+
+    if (m_size < sizeof(word_run_footer)) {
+      ::close(fd);
+      throw std::runtime_error(path + " is not a word run");
+    }
+
+    void *data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      throw std::system_error(error, std::generic_category(),
+                              "can not map " + path);
+    }
+    m_data = static_cast<const char *>(data);
+
+    std::memcpy(&m_footer, m_data + m_size - sizeof(word_run_footer),
+                sizeof(word_run_footer));
+    if (!valid()) {
+      unmap();
+      throw std::runtime_error(path + " is not a valid word run");
+    }
+  }
+
+  word_run(const word_run &) = delete;
+  word_run &operator=(const word_run &) = delete;
+
+  ~word_run() { unmap(); }
+
+  const std::string &path() const { return m_path; }
+
+  // The number of distinct words
+  std::uint64_t size() const { return m_footer.record_count; }
+
+  word_run_cursor cursor() const {
+    return word_run_cursor(m_data, m_data + m_footer.index_offset);
+  }
+
+  std::uint64_t count(std::string_view word) const {
+    // The first indexed record after the word, the word can only
+    // be in the part of the run before it
+    std::uint64_t low = 0;
+    std::uint64_t high = m_footer.index_count;
+    while (low < high) {
+      const auto middle = low + (high - low) / 2;
+      if (cursor_at(middle).word() <= word) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    if (low == 0) {
+      return 0;
+    }
+
+    auto cursor = cursor_at(low - 1);
+    while (!cursor.done() && cursor.word() < word) {
+      cursor.next();
+    }
+    return !cursor.done() && cursor.word() == word ? cursor.count() : 0;
+  }
+
+private:
+  std::uint64_t index_entry(std::uint64_t entry) const {
+    std::uint64_t offset;
+    std::memcpy(&offset,
+                m_data + m_footer.index_offset + entry * sizeof(std::uint64_t),
+                sizeof(offset));
+    return offset;
+  }
+
+  word_run_cursor cursor_at(std::uint64_t entry) const {
+    return word_run_cursor(m_data + index_entry(entry),
+                           m_data + m_footer.index_offset);
+  }
+
+  // Checks the footer, and that the index only points at records,
+  // so that the cursors never leave the mapping. The records are
+  // checked by the cursors as they are read.
+  bool valid() const {
+    if (std::memcmp(m_footer.magic, word_run_format::magic,
+                    sizeof(m_footer.magic)) != 0 ||
+        m_footer.byte_order != word_run_format::byte_order ||
+        m_footer.version != word_run_format::version) {
+      return false;
+    }
+
+    // Written so that none of it can overflow
+    const std::uint64_t body_size = m_size - sizeof(word_run_footer);
+    if (m_footer.index_count > body_size / sizeof(std::uint64_t) ||
+        m_footer.index_offset !=
+            body_size - m_footer.index_count * sizeof(std::uint64_t)) {
+      return false;
+    }
+
+    // Every record is at least a header, and every index_interval-th
+    // of them is in the index, starting with the first one
+    const auto interval = word_run_format::index_interval;
+    if (m_footer.record_count >
+            m_footer.index_offset / word_run_format::record_header_size ||
+        m_footer.index_count !=
+            (m_footer.record_count + interval - 1) / interval) {
+      return false;
+    }
+
+    for (std::uint64_t entry = 0; entry < m_footer.index_count; ++entry) {
+      const auto offset = index_entry(entry);
+      if (offset >= m_footer.index_offset ||
+          (entry == 0 ? offset != 0 : offset <= index_entry(entry - 1))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void unmap() {
+    if (m_data) {
+      ::munmap(const_cast<char *>(m_data), m_size);
+      m_data = nullptr;
+    }
+  }
+
+  std::string m_path;
+  const char *m_data = nullptr;
+  std::size_t m_size = 0;
+  word_run_footer m_footer{};
+};
+
+// Writes a run, the words need to be added in increasing order. The
+// records are written to path.tmp as they are added, only the index
+// is kept in memory, and the file is renamed when it is finished.
+class word_run_writer {
+public:
+  explicit word_run_writer(std::string path)
+      : m_path(std::move(path)),
+        m_out(m_path + ".tmp", std::ios::binary | std::ios::trunc) {
+    if (!m_out) {
+      throw std::runtime_error("can not write " + m_path);
+    }
+  }
+
+  word_run_writer(const word_run_writer &) = delete;
+  word_run_writer &operator=(const word_run_writer &) = delete;
+
+  ~word_run_writer() {
+    if (!m_finished) {
+      m_out.close();
+      std::error_code ignored;
+      std::filesystem::remove(m_path + ".tmp", ignored);
+    }
+  }
+
+  void add(std::string_view word, std::uint64_t count) {
+    if (m_record_count % word_run_format::index_interval == 0) {
+      m_index.push_back(m_offset + m_buffer.size());
+    }
+    word_run_format::append_record(m_buffer, word, count);
+    ++m_record_count;
+    if (m_buffer.size() >= buffer_size) {
+      write_buffer();
+    }
+  }
+
+  void finish() {
+    write_buffer();
+
+    word_run_footer footer{};
+    footer.record_count = m_record_count;
+    footer.index_offset = m_offset;
+    footer.index_count = m_index.size();
+    footer.byte_order = word_run_format::byte_order;
+    footer.version = word_run_format::version;
+    std::memcpy(footer.magic, word_run_format::magic, sizeof(footer.magic));
+
+    m_out.write(reinterpret_cast<const char *>(m_index.data()),
+                m_index.size() * sizeof(std::uint64_t));
+    m_out.write(reinterpret_cast<const char *>(&footer), sizeof(footer));
+    m_out.close();
+    if (!m_out) {
+      throw std::runtime_error("can not write " + m_path);
+    }
+
+    std::filesystem::rename(m_path + ".tmp", m_path);
+    m_finished = true;
+  }
+
+private:
+  static constexpr std::size_t buffer_size = 1 << 16;
+
+  void write_buffer() {
+    m_out.write(m_buffer.data(), m_buffer.size());
+    m_offset += m_buffer.size();
+    m_buffer.clear();
+  }
+
+  std::string m_path;
+  std::ofstream m_out;
+  std::string m_buffer;
+  std::vector<std::uint64_t> m_index;
+  std::uint64_t m_offset = 0;
+  std::uint64_t m_record_count = 0;
+  bool m_finished = false;
+};
+
+struct word_count_options {
+  // The number of distinct words counted in memory before
+  // they are written to a run
+  std::size_t memory_words = 1 << 20;
+
+  // The number of runs of the same tier which are merged into one
+  std::size_t merge_factor = 4;
+};
+
+class word_count_index {
+public:
+  explicit word_count_index(std::filesystem::path directory,
+                            word_count_options options = {})
+      : m_directory(std::move(directory)), m_options(options) {
+    m_options.memory_words = std::max<std::size_t>(1, m_options.memory_words);
+    m_options.merge_factor = std::max<std::size_t>(2, m_options.merge_factor);
+
+    std::filesystem::create_directories(m_directory);
+    open_runs();
+    m_merger = std::thread([this] { merge_runs(); });
+  }
+
+  word_count_index(const word_count_index &) = delete;
+  word_count_index &operator=(const word_count_index &) = delete;
+
+  // Writes the words counted in memory. The errors can not be
+  // reported from here, call flush() first to see them.
+  ~word_count_index() {
+    try {
+      flush();
+    } catch (...) {
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_merger.join();
+  }
+
+  void add(std::string_view word, unsigned int count = 1) {
+    if (word.size() >
+        string_histogram::max_arena_size - m_memory.arena_size()) {
+      flush();
+    }
+    if (!m_memory.try_add(word, count)) {
+      // The count continues in the run
+      flush();
+      m_memory.add(word, count);
+    }
+    if (m_memory.size() >= m_options.memory_words) {
+      flush();
+    }
+  }
+
+  template <typename C> void add_words(const C &words) {
+    for (const auto &word : words) {
+      add(word);
+    }
+  }
+
+  // Writes the words counted in memory to a new run. Rethrows
+  // the error if a background merge has failed.
+  void flush() {
+    rethrow_merge_error();
+    if (m_memory.empty()) {
+      return;
+    }
+
+    std::vector<string_histogram::value_type> words(m_memory.begin(),
+                                                    m_memory.end());
+    std::sort(words.begin(), words.end());
+
+    const auto sequence = m_next_sequence;
+    const auto path = run_path(sequence, sequence);
+    word_run_writer writer(path);
+    for (const auto &[word, count] : words) {
+      writer.add(word, count);
+    }
+    writer.finish();
+    run_t run{sequence, sequence, std::make_shared<const word_run>(path)};
+
+    ++m_next_sequence;
+    m_memory = string_histogram();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_runs.push_back(std::move(run));
+    }
+    m_wake.notify_one();
+  }
+
+  // Blocks until the background thread has nothing left to merge
+  void wait_for_merges() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] {
+      return m_merge_error || (!m_merging && !mergeable_runs());
+    });
+    if (m_merge_error) {
+      std::rethrow_exception(m_merge_error);
+    }
+  }
+
+  std::uint64_t count(std::string_view word) const {
+    std::uint64_t result = m_memory.count(word);
+    for (const auto &run : runs()) {
+      result += run.file->count(word);
+    }
+    return result;
+  }
+
+  // The k most frequent words, as (count, word) pairs,
+  // ordered like top_k_by_frequency orders them
+  std::vector<std::pair<std::uint64_t, std::string>>
+  top_k(std::size_t k) const {
+    const auto current_runs = runs();
+
+    std::vector<string_histogram::value_type> words(m_memory.begin(),
+                                                    m_memory.end());
+    std::sort(words.begin(), words.end());
+    std::string memory;
+    for (const auto &[word, count] : words) {
+      word_run_format::append_record(memory, word, count);
+    }
+
+    std::vector<word_run_cursor> cursors;
+    for (const auto &run : current_runs) {
+      cursors.push_back(run.file->cursor());
+    }
+    cursors.emplace_back(memory.data(), memory.data() + memory.size());
+
+    top_k_heap<std::string_view, std::uint64_t> heap(k);
+    merge_word_runs(std::move(cursors),
+                    [&heap](std::string_view word, std::uint64_t count) {
+                      heap.add(count, word);
+                    });
+
+    std::vector<std::pair<std::uint64_t, std::string>> result;
+    for (const auto &[count, word] : std::move(heap).take()) {
+      result.emplace_back(count, std::string(word));
+    }
+    return result;
+  }
+
+  // The number of runs on disk
+  std::size_t run_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_runs.size();
+  }
+
+private:
+  // A run with the flushes from first to last
+  struct run_t {
+    std::uint64_t first;
+    std::uint64_t last;
+    std::shared_ptr<const word_run> file;
+  };
+
+  static constexpr int sequence_digits = 10;
+
+  std::string run_path(std::uint64_t first, std::uint64_t last) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%0*llu-%0*llu.run", sequence_digits,
+                  static_cast<unsigned long long>(first), sequence_digits,
+                  static_cast<unsigned long long>(last));
+    return (m_directory / name).string();
+  }
+
+  static std::optional<run_t> parse_run_name(std::string_view name) {
+    const std::string_view extension = ".run";
+    if (name.size() != 2 * sequence_digits + 1 + extension.size() ||
+        name[sequence_digits] != '-' ||
+        name.substr(2 * sequence_digits + 1) != extension) {
+      return {};
+    }
+
+    run_t result{};
+    const auto first = name.data();
+    const auto last = first + sequence_digits + 1;
+    if (std::from_chars(first, first + sequence_digits, result.first).ptr !=
+            first + sequence_digits ||
+        std::from_chars(last, last + sequence_digits, result.last).ptr !=
+            last + sequence_digits ||
+        result.first > result.last) {
+      return {};
+    }
+    return result;
+  }
+
+  void open_runs() {
+    std::vector<run_t> found;
+    for (const auto &entry : std::filesystem::directory_iterator(m_directory)) {
+      const auto name = entry.path().filename().string();
+      if (const auto run = parse_run_name(name)) {
+        found.push_back(*run);
+      } else if (name.size() > 8 &&
+                 name.compare(name.size() - 8, 8, ".run.tmp") == 0) {
+        // An unfinished run
+        std::filesystem::remove(entry.path());
+      }
+    }
+
+    // A run that another run contains is a leftover of a merge
+    std::sort(found.begin(), found.end(),
+              [](const run_t &left, const run_t &right) {
+                return left.first != right.first ? left.first < right.first
+                                                 : left.last > right.last;
+              });
+    for (const auto &run : found) {
+      const auto path = run_path(run.first, run.last);
+      if (!m_runs.empty() && run.last <= m_runs.back().last) {
+        std::filesystem::remove(path);
+        continue;
+      }
+      m_runs.push_back({run.first, run.last,
+                        std::make_shared<const word_run>(path)});
+    }
+
+    m_next_sequence = m_runs.empty() ? 0 : m_runs.back().last + 1;
+  }
+
+  std::vector<run_t> runs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_runs;
+  }
+
+  void rethrow_merge_error() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_merge_error) {
+      std::rethrow_exception(m_merge_error);
+    }
+  }
+
+  std::size_t tier(const run_t &run) const {
+    std::size_t result = 0;
+    for (auto flushes = run.last - run.first + 1;
+         flushes >= m_options.merge_factor;
+         flushes /= m_options.merge_factor) {
+      ++result;
+    }
+    return result;
+  }
+
+  // The position of the oldest merge_factor neighbouring runs of the
+  // same tier. Needs to be called with the mutex locked.
+  //
+  // The tiers of the runs never increase from the oldest run to the
+  // newest one -- the flushes append runs of tier 0, and merging the
+  // oldest runs of a tier puts the new run after the runs of the
+  // higher tiers. Merging newer runs first could leave a run behind
+  // between two runs of a higher tier, where it would never be merged.
+  std::optional<std::size_t> mergeable_runs() const {
+    const auto factor = m_options.merge_factor;
+    if (m_runs.size() < factor) {
+      return {};
+    }
+    for (std::size_t first = 0; first + factor <= m_runs.size(); ++first) {
+      const auto first_tier = tier(m_runs[first]);
+      if (std::all_of(m_runs.begin() + first + 1,
+                      m_runs.begin() + first + factor,
+                      [&](const run_t &run) {
+                        return tier(run) == first_tier;
+                      })) {
+        return first;
+      }
+    }
+    return {};
+  }
+
+  run_t merge(const std::vector<run_t> &inputs) const {
+    const auto first = inputs.front().first;
+    const auto last = inputs.back().last;
+    const auto path = run_path(first, last);
+
+    std::vector<word_run_cursor> cursors;
+    for (const auto &input : inputs) {
+      cursors.push_back(input.file->cursor());
+    }
+
+    word_run_writer writer(path);
+    merge_word_runs(std::move(cursors),
+                    [&writer](std::string_view word, std::uint64_t count) {
+                      writer.add(word, count);
+                    });
+    writer.finish();
+    return {first, last, std::make_shared<const word_run>(path)};
+  }
+
+  // The background thread. Only this thread removes runs, the flushes
+  // only append them, so the runs being merged stay next to each other.
+  void merge_runs() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+      const auto first = m_merge_error ? std::nullopt : mergeable_runs();
+      if (!first) {
+        m_merging = false;
+        m_idle.notify_all();
+        m_wake.wait(lock);
+        continue;
+      }
+
+      m_merging = true;
+      const std::vector<run_t> inputs(m_runs.begin() + *first,
+                                      m_runs.begin() + *first +
+                                          m_options.merge_factor);
+      lock.unlock();
+
+      std::optional<run_t> merged;
+      try {
+        merged = merge(inputs);
+      } catch (...) {
+        lock.lock();
+        m_merge_error = std::current_exception();
+        continue;
+      }
+
+      lock.lock();
+      auto position = std::find_if(
+          m_runs.begin(), m_runs.end(),
+          [&](const run_t &run) { return run.file == inputs.front().file; });
+      position = m_runs.erase(position, position + inputs.size());
+      m_runs.insert(position, std::move(*merged));
+      lock.unlock();
+
+      // The queries which are still reading the old runs keep them
+      // mapped, the files are gone only when they finish
+      for (const auto &input : inputs) {
+        std::error_code ignored;
+        std::filesystem::remove(input.file->path(), ignored);
+      }
+      lock.lock();
+    }
+
+    m_merging = false;
+    m_idle.notify_all();
+  }
+
+  std::filesystem::path m_directory;
+  word_count_options m_options;
+  string_histogram m_memory;
+  std::uint64_t m_next_sequence = 0;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  std::vector<run_t> m_runs;
+  bool m_merging = false;
+  bool m_stopping = false;
+  std::exception_ptr m_merge_error;
+
+  std::thread m_merger;
+};
+
+#endif // WORD_COUNT_INDEX_H